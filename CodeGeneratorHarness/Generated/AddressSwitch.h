@@ -0,0 +1,84 @@
+// Generated from a DFA with 6 reachable states, do not edit.
+#ifndef LFA_GENERATED_ADDRESSSWITCH_H
+#define LFA_GENERATED_ADDRESSSWITCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace AddressSwitch
+{
+	template <typename Iterator>
+	bool IsAccepted(Iterator first, Iterator last)
+	{
+	state_0:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 48: case 49: case 50: case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 95: case 97: case 98: case 99: case 100: case 101: case 102: case 103: case 104: case 105: case 106: case 107: case 108: case 109: case 110: case 111: case 112: case 113: case 114: case 115: case 116: case 117: case 118: case 119: case 120: case 121: case 122: goto state_1;
+			default: return false;
+		}
+
+	state_1:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 46: goto state_0;
+			case 48: case 49: case 50: case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 95: case 97: case 98: case 99: case 100: case 101: case 102: case 103: case 104: case 105: case 106: case 107: case 108: case 109: case 110: case 111: case 112: case 113: case 114: case 115: case 116: case 117: case 118: case 119: case 120: case 121: case 122: goto state_1;
+			case 64: goto state_2;
+			default: return false;
+		}
+
+	state_2:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 48: case 49: case 50: case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 95: case 97: case 98: case 99: case 100: case 101: case 102: case 103: case 104: case 105: case 106: case 107: case 108: case 109: case 110: case 111: case 112: case 113: case 114: case 115: case 116: case 117: case 118: case 119: case 120: case 121: case 122: goto state_3;
+			default: return false;
+		}
+
+	state_3:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 46: goto state_4;
+			case 48: case 49: case 50: case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 95: case 97: case 98: case 99: case 100: case 101: case 102: case 103: case 104: case 105: case 106: case 107: case 108: case 109: case 110: case 111: case 112: case 113: case 114: case 115: case 116: case 117: case 118: case 119: case 120: case 121: case 122: goto state_3;
+			default: return false;
+		}
+
+	state_4:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 48: case 49: case 50: case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 95: case 97: case 98: case 99: case 100: case 101: case 102: case 103: case 104: case 105: case 106: case 107: case 108: case 109: case 110: case 111: case 112: case 113: case 114: case 115: case 116: case 117: case 118: case 119: case 120: case 121: case 122: goto state_5;
+			default: return false;
+		}
+
+	state_5:
+		if (first == last)
+			return true;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 46: goto state_4;
+			case 48: case 49: case 50: case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 95: case 97: case 98: case 99: case 100: case 101: case 102: case 103: case 104: case 105: case 106: case 107: case 108: case 109: case 110: case 111: case 112: case 113: case 114: case 115: case 116: case 117: case 118: case 119: case 120: case 121: case 122: goto state_5;
+			default: return false;
+		}
+	}
+
+	inline bool IsAccepted(char const* word, std::size_t length)
+	{
+		return IsAccepted(word, word + length);
+	}
+}
+
+#endif
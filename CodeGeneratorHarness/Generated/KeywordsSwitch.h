@@ -0,0 +1,429 @@
+// Generated from a DFA with 40 reachable states, do not edit.
+#ifndef LFA_GENERATED_KEYWORDSSWITCH_H
+#define LFA_GENERATED_KEYWORDSSWITCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace KeywordsSwitch
+{
+	template <typename Iterator>
+	bool IsAccepted(Iterator first, Iterator last)
+	{
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 98: goto state_1;
+			case 99: goto state_2;
+			case 100: goto state_3;
+			case 101: goto state_4;
+			case 102: goto state_5;
+			case 103: goto state_6;
+			case 105: goto state_7;
+			case 114: goto state_8;
+			case 115: goto state_9;
+			case 119: goto state_10;
+			default: return false;
+		}
+
+	state_1:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 114: goto state_11;
+			default: return false;
+		}
+
+	state_2:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 97: goto state_12;
+			case 111: goto state_13;
+			default: return false;
+		}
+
+	state_3:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 101: goto state_14;
+			case 111: goto state_15;
+			default: return false;
+		}
+
+	state_4:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 108: goto state_12;
+			default: return false;
+		}
+
+	state_5:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 111: goto state_16;
+			default: return false;
+		}
+
+	state_6:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 111: goto state_17;
+			default: return false;
+		}
+
+	state_7:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 102: goto state_15;
+			default: return false;
+		}
+
+	state_8:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 101: goto state_18;
+			default: return false;
+		}
+
+	state_9:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 119: goto state_19;
+			default: return false;
+		}
+
+	state_10:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 104: goto state_20;
+			default: return false;
+		}
+
+	state_11:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 101: goto state_21;
+			default: return false;
+		}
+
+	state_12:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 115: goto state_22;
+			default: return false;
+		}
+
+	state_13:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 110: goto state_23;
+			default: return false;
+		}
+
+	state_14:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 102: goto state_24;
+			default: return false;
+		}
+
+	state_15:
+		if (first == last)
+			return true;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			default: return false;
+		}
+
+	state_16:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 114: goto state_15;
+			default: return false;
+		}
+
+	state_17:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 116: goto state_25;
+			default: return false;
+		}
+
+	state_18:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 116: goto state_26;
+			default: return false;
+		}
+
+	state_19:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 105: goto state_27;
+			default: return false;
+		}
+
+	state_20:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 105: goto state_28;
+			default: return false;
+		}
+
+	state_21:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 97: goto state_29;
+			default: return false;
+		}
+
+	state_22:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 101: goto state_15;
+			default: return false;
+		}
+
+	state_23:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 116: goto state_30;
+			default: return false;
+		}
+
+	state_24:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 97: goto state_31;
+			default: return false;
+		}
+
+	state_25:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 111: goto state_15;
+			default: return false;
+		}
+
+	state_26:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 117: goto state_32;
+			default: return false;
+		}
+
+	state_27:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 116: goto state_33;
+			default: return false;
+		}
+
+	state_28:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 108: goto state_22;
+			default: return false;
+		}
+
+	state_29:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 107: goto state_15;
+			default: return false;
+		}
+
+	state_30:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 105: goto state_34;
+			default: return false;
+		}
+
+	state_31:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 117: goto state_35;
+			default: return false;
+		}
+
+	state_32:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 114: goto state_36;
+			default: return false;
+		}
+
+	state_33:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 99: goto state_37;
+			default: return false;
+		}
+
+	state_34:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 110: goto state_38;
+			default: return false;
+		}
+
+	state_35:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 108: goto state_39;
+			default: return false;
+		}
+
+	state_36:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 110: goto state_15;
+			default: return false;
+		}
+
+	state_37:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 104: goto state_15;
+			default: return false;
+		}
+
+	state_38:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 117: goto state_22;
+			default: return false;
+		}
+
+	state_39:
+		if (first == last)
+			return false;
+
+		switch (static_cast<unsigned char>(*first++))
+		{
+			case 116: goto state_15;
+			default: return false;
+		}
+	}
+
+	inline bool IsAccepted(char const* word, std::size_t length)
+	{
+		return IsAccepted(word, word + length);
+	}
+}
+
+#endif
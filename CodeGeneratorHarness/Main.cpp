@@ -0,0 +1,331 @@
+// Checks the matchers CodeGenerator writes against DFA::IsAccepted on random words,
+// then times both generated styles against DFA::IsAccepted.
+//	CodeGeneratorHarness [directory]			checks and benchmarks, directory holds the generated headers
+//	CodeGeneratorHarness write [directory]		writes the generated headers again
+// The headers are included below, so they are written once and compiled in. The check first
+// writes them again next to the included ones, so a stale header is reported instead of tested.
+// Headers which do not exist yet are written by a build with LFA_HARNESS_WRITE_ONLY defined.
+#include "PCH.h"
+#include "AutomataBuilder.h"
+#include "CodeGenerator.h"
+#include "TransitionTable.h"
+
+#include <random>
+#include <sstream>
+
+#ifndef LFA_HARNESS_WRITE_ONLY
+#include "Generated/KeywordsTable.h"
+#include "Generated/KeywordsSwitch.h"
+#include "Generated/AddressTable.h"
+#include "Generated/AddressSwitch.h"
+#endif
+
+namespace
+{
+	uint32 const CheckedWords = 200000;
+	uint32 const BenchmarkWords = 1 << 20;
+	uint32 const BenchmarkRounds = 5;
+	uint32 const MaximumWalkLength = 32;
+
+	struct Pattern
+	{
+		String name;	// The headers are name + "Table.h" and name + "Switch.h", with namespaces of the same names.
+		DFA dfa;
+	};
+
+	// The C control flow keywords.
+	DFA BuildKeywords()
+	{
+		char const* keywords[] = { "break", "case", "continue", "default", "do", "else", "for", "goto", "if", "return",
+			"switch", "while" };
+
+		AutomataBuilder builder;
+		AutomataBuilder::FragmentsVector words;
+
+		for (uint32 i = 0; i < sizeof(keywords) / sizeof(keywords[0]); ++i)
+			words.push_back(builder.Word(keywords[i]));
+
+		return builder.Build(builder.Union(words)).GetMinimalDFA();
+	}
+
+	// [0-9a-z_]+(\.[0-9a-z_]+)*@[0-9a-z_]+(\.[0-9a-z_]+)+, a mail address.
+	DFA BuildAddress()
+	{
+		AutomataBuilder builder;
+
+		auto letters = [&builder]()
+		{
+			AutomataBuilder::FragmentsVector symbols(1, builder.Symbol('_'));
+
+			for (char key = '0'; key <= '9'; ++key)
+				symbols.push_back(builder.Symbol(key));
+
+			for (char key = 'a'; key <= 'z'; ++key)
+				symbols.push_back(builder.Symbol(key));
+
+			return builder.Plus(builder.Union(symbols));
+		};
+
+		auto dotted = [&builder, &letters]() { return builder.Concatenate(builder.Symbol('.'), letters()); };
+
+		AutomataBuilder::FragmentsVector parts;
+
+		parts.push_back(letters());
+		parts.push_back(builder.Star(dotted()));
+		parts.push_back(builder.Symbol('@'));
+		parts.push_back(letters());
+		parts.push_back(builder.Plus(dotted()));
+
+		return builder.Build(builder.Concatenate(parts)).GetMinimalDFA();
+	}
+
+	Vector<Pattern> GetPatterns()
+	{
+		Vector<Pattern> patterns(2);
+
+		patterns[0].name = "Keywords";
+		patterns[0].dfa = BuildKeywords();
+		patterns[1].name = "Address";
+		patterns[1].dfa = BuildAddress();
+
+		return patterns;
+	}
+
+	String GetPath(String const& directory, String const& name)
+	{
+		return directory + "/" + name + ".h";
+	}
+
+	bool WriteHeader(DFA const& dfa, String const& name, CodeGenerator::Style const& style, String const& path)
+	{
+		std::ofstream ofs(path);
+
+		if (!ofs.is_open())
+			return false;
+
+		CodeGenerator::Write(dfa, name, style, ofs);
+		return true;
+	}
+
+	bool WriteHeaders(Vector<Pattern> const& patterns, String const& directory)
+	{
+		for (Vector<Pattern>::const_iterator itr = patterns.begin(); itr != patterns.end(); ++itr)
+			if (!WriteHeader(itr->dfa, itr->name + "Table", CodeGenerator::STYLE_TABLE, GetPath(directory, itr->name + "Table")) ||
+				!WriteHeader(itr->dfa, itr->name + "Switch", CodeGenerator::STYLE_SWITCH, GetPath(directory, itr->name + "Switch")))
+			{
+				std::cerr << "Cannot write the headers of " << itr->name << " to " << directory << "\n";
+				return false;
+			}
+
+		return true;
+	}
+
+#ifndef LFA_HARNESS_WRITE_ONLY
+	// Compares line by line, so a checkout with other line endings still matches.
+	bool HaveSameLines(String const& firstPath, String const& secondPath)
+	{
+		std::ifstream first(firstPath), second(secondPath);
+		String firstLine, secondLine;
+
+		if (!first.is_open() || !second.is_open())
+			return false;
+
+		while (true)
+		{
+			bool const firstRead = static_cast<bool>(std::getline(first, firstLine));
+			bool const secondRead = static_cast<bool>(std::getline(second, secondLine));
+
+			if (!firstRead || !secondRead)
+				return firstRead == secondRead;
+
+			if (!firstLine.empty() && firstLine.back() == '\r')
+				firstLine.pop_back();
+
+			if (!secondLine.empty() && secondLine.back() == '\r')
+				secondLine.pop_back();
+
+			if (firstLine != secondLine)
+				return false;
+		}
+	}
+
+	// The written header is left next to a stale one, so the two can be compared.
+	bool AreHeadersCurrent(Vector<Pattern> const& patterns, String const& directory)
+	{
+		bool current = true;
+
+		for (Vector<Pattern>::const_iterator itr = patterns.begin(); itr != patterns.end(); ++itr)
+			for (uint32 i = 0; i < 2; ++i)
+			{
+				String const name = itr->name + (i ? "Switch" : "Table");
+				String const path = GetPath(directory, name);
+				String const writtenPath = path + ".new";
+
+				if (!WriteHeader(itr->dfa, name, i ? CodeGenerator::STYLE_SWITCH : CodeGenerator::STYLE_TABLE, writtenPath))
+				{
+					std::cerr << "Cannot write " << writtenPath << "\n";
+					return false;
+				}
+
+				if (HaveSameLines(path, writtenPath))
+				{
+					std::remove(writtenPath.c_str());
+					continue;
+				}
+
+				std::cerr << path << " is stale, compare it with " << writtenPath << " and run the write command.\n";
+				current = false;
+			}
+
+		return current;
+	}
+
+	// A random walk from the initial state, which the DFA mostly accepts when it stops in a final state,
+	// changed at a random position half of the time so the rejecting paths are taken too.
+	String GenerateWord(DFA const& dfa, TransitionTable const& table, std::mt19937* random)
+	{
+		uint32 const length = (*random)() % (MaximumWalkLength + 1);
+		uint32 state = dfa.GetInitialState();
+		String word;
+
+		while (word.size() < length && table.GetEdgesBegin(state) != table.GetEdgesEnd(state))
+		{
+			uint32 const edge = table.GetEdgesBegin(state) + (*random)() % (table.GetEdgesEnd(state) - table.GetEdgesBegin(state));
+
+			word += table.GetSymbol(edge);
+			state = *table.GetTargets(edge).first;
+		}
+
+		if ((*random)() % 2)
+		{
+			char const key = static_cast<char>((*random)() % 256);
+			uint32 const position = (*random)() % (word.size() + 1);
+
+			if (position == word.size() || (*random)() % 2)
+				word.insert(word.begin() + position, key);
+			else
+				word[position] = key;
+		}
+
+		return word;
+	}
+
+	template <typename TableFunction, typename SwitchFunction>
+	bool Check(Pattern const& pattern, TableFunction const& table, SwitchFunction const& switchMatcher, std::mt19937* random)
+	{
+		TransitionTable const& transitionTable = pattern.dfa.GetTransitionTable();
+		uint32 accepted = 0;
+
+		for (uint32 i = 0; i < CheckedWords; ++i)
+		{
+			String const word = GenerateWord(pattern.dfa, transitionTable, random);
+			bool const expected = pattern.dfa.IsAccepted(word);
+
+			if (table(word) != expected || switchMatcher(word) != expected)
+			{
+				std::cerr << pattern.name << ": the generated matchers disagree with IsAccepted on \"" << word << "\"\n";
+				return false;
+			}
+
+			accepted += expected ? 1 : 0;
+		}
+
+		std::cout << pattern.name << ": " << pattern.dfa.GetStatesCount() << " states, " << CheckedWords << " words checked, "
+			<< accepted << " accepted\n";
+		return true;
+	}
+
+	// Nanoseconds per byte of the fastest round, the accepted count keeps the calls from being optimized away.
+	template <typename Function>
+	double Time(Vector<String> const& words, uint64 const& bytes, Function const& function, uint32* accepted)
+	{
+		double best = 0.0;
+
+		for (uint32 round = 0; round < BenchmarkRounds; ++round)
+		{
+			std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+			uint32 count = 0;
+
+			for (Vector<String>::const_iterator itr = words.begin(); itr != words.end(); ++itr)
+				count += function(*itr) ? 1 : 0;
+
+			double const elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count()) / static_cast<double>(bytes);
+
+			if (!round || elapsed < best)
+				best = elapsed;
+
+			*accepted = count;
+		}
+
+		return best;
+	}
+
+	// The generated matchers are called through lambdas of their own, so they can be inlined.
+	template <typename TableFunction, typename SwitchFunction>
+	void Benchmark(Pattern const& pattern, TableFunction const& table, SwitchFunction const& switchMatcher, std::mt19937* random)
+	{
+		TransitionTable const& transitionTable = pattern.dfa.GetTransitionTable();
+		Vector<String> words(BenchmarkWords);
+		uint64 bytes = 0;
+		uint32 accepted[3];
+
+		for (Vector<String>::iterator itr = words.begin(); itr != words.end(); ++itr)
+		{
+			*itr = GenerateWord(pattern.dfa, transitionTable, random);
+			bytes += itr->size();
+		}
+
+		bytes = std::max<uint64>(bytes, 1);
+
+		double const dfa = Time(words, bytes, [&pattern](String const& word) { return pattern.dfa.IsAccepted(word); }, &accepted[0]);
+		double const generatedTable = Time(words, bytes, table, &accepted[1]);
+		double const generatedSwitch = Time(words, bytes, switchMatcher, &accepted[2]);
+
+		assert(accepted[0] == accepted[1] && accepted[0] == accepted[2]);
+
+		std::ostringstream oss;
+		oss.setf(std::ios::fixed);
+		oss.precision(2);
+		oss << pattern.name << ": " << words.size() << " words, " << bytes << " bytes, " << accepted[0] << " accepted\n"
+			<< "\tDFA::IsAccepted  " << dfa << " ns/byte\n"
+			<< "\tSTYLE_TABLE      " << generatedTable << " ns/byte\n"
+			<< "\tSTYLE_SWITCH     " << generatedSwitch << " ns/byte\n";
+
+		std::cout << oss.str();
+	}
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+	Vector<String> const arguments(argv + 1, argv + argc);
+	Vector<Pattern> const patterns = GetPatterns();
+
+	if (!arguments.empty() && arguments[0] == "write")
+		return WriteHeaders(patterns, (arguments.size() > 1) ? arguments[1] : "Generated") ? 0 : 1;
+
+#ifndef LFA_HARNESS_WRITE_ONLY
+	if (!AreHeadersCurrent(patterns, !arguments.empty() ? arguments[0] : "Generated"))
+		return 1;
+
+	std::mt19937 random(2017);
+
+	// Both overloads of both styles are checked.
+	auto keywordsTable = [](String const& word) { return KeywordsTable::IsAccepted(word.data(), word.size()); };
+	auto keywordsSwitch = [](String const& word) { return KeywordsSwitch::IsAccepted(word.begin(), word.end()); };
+	auto addressTable = [](String const& word) { return AddressTable::IsAccepted(word.begin(), word.end()); };
+	auto addressSwitch = [](String const& word) { return AddressSwitch::IsAccepted(word.data(), word.size()); };
+
+	if (!Check(patterns[0], keywordsTable, keywordsSwitch, &random) || !Check(patterns[1], addressTable, addressSwitch, &random))
+		return 1;
+
+	Benchmark(patterns[0], keywordsTable, keywordsSwitch, &random);
+	Benchmark(patterns[1], addressTable, addressSwitch, &random);
+
+	return 0;
+#else
+	std::cerr << "Built with LFA_HARNESS_WRITE_ONLY, only the write command is available.\n";
+	return 1;
+#endif
+}
@@ -0,0 +1,304 @@
+#include "PCH.h"
+#include "AutomataBuilder.h"
+#include "TransitionTable.h"
+#include "Statistics.h"
+
+uint32 const AutomataBuilder::Unbounded;
+
+AutomataBuilder::Fragment AutomataBuilder::Empty()
+{
+	uint32 const state = AddState();
+	return Fragment(state, state);
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Symbol(char const& key)
+{
+	uint32 const entry = AddState();
+	uint32 const exit = AddState();
+
+	AddTransition(entry, key, exit);
+	return Fragment(entry, exit);
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Word(String const& word)
+{
+	Fragment fragment = Empty();
+
+	for (String::const_iterator itr = word.begin(); itr != word.end(); ++itr)
+	{
+		uint32 const state = AddState();
+
+		AddTransition(fragment.exit, *itr, state);
+		fragment.exit = state;
+	}
+
+	return fragment;
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Append(FiniteAutomata const& automaton)
+{
+	if (!automaton.HasStates())
+		return Fragment(AddState(), AddState());
+
+	TransitionTable const& table = automaton.GetTransitionTable();
+	TransitionTable const& lambdaTable = automaton.GetLambdaTable();
+	StatesSet const finalStates = automaton.GetFinalStates();
+	uint32 const offset = GetStatesCount();
+
+	for (uint32 state = 0; state < automaton.GetStatesCount(); ++state)
+		AddState();
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+		{
+			TargetsRange targets = table.GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				AddTransition(state + offset, table.GetSymbol(edge), (*itr) + offset);
+		}
+
+	for (uint32 state = 0; state < lambdaTable.GetStates(); ++state)
+	{
+		TargetsRange targets = lambdaTable.Find(state, FiniteAutomata::Lambda);
+
+		for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+			AddLambdaTransition(state + offset, (*itr) + offset);
+	}
+
+	// The final states may have transitions, so the exit is a state of its own.
+	Fragment fragment(automaton.GetInitialState() + offset, AddState());
+
+	for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		AddLambdaTransition((*itr) + offset, fragment.exit);
+
+	return fragment;
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Union(Fragment const& first, Fragment const& second)
+{
+	return Union(FragmentsVector({ first, second }));
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Union(FragmentsVector const& fragments)
+{
+	assert(!fragments.empty());
+
+	Fragment fragment(AddState(), AddState());
+
+	for (FragmentsVector::const_iterator itr = fragments.begin(); itr != fragments.end(); ++itr)
+	{
+		AddLambdaTransition(fragment.entry, itr->entry);
+		AddLambdaTransition(itr->exit, fragment.exit);
+	}
+
+	return fragment;
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Concatenate(Fragment const& first, Fragment const& second)
+{
+	AddLambdaTransition(first.exit, second.entry);
+	return Fragment(first.entry, second.exit);
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Concatenate(FragmentsVector const& fragments)
+{
+	assert(!fragments.empty());
+
+	for (uint32 i = 1; i < fragments.size(); ++i)
+		AddLambdaTransition(fragments[i - 1].exit, fragments[i].entry);
+
+	return Fragment(fragments.front().entry, fragments.back().exit);
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Star(Fragment const& fragment)
+{
+	Fragment star(AddState(), AddState());
+
+	AddLambdaTransition(star.entry, fragment.entry);
+	AddLambdaTransition(star.entry, star.exit);
+	AddLambdaTransition(fragment.exit, fragment.entry);
+	AddLambdaTransition(fragment.exit, star.exit);
+
+	return star;
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Plus(Fragment const& fragment)
+{
+	Fragment plus(fragment.entry, AddState());
+
+	AddLambdaTransition(fragment.exit, fragment.entry);
+	AddLambdaTransition(fragment.exit, plus.exit);
+
+	return plus;
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Optional(Fragment const& fragment)
+{
+	Fragment optional(AddState(), fragment.exit);
+
+	AddLambdaTransition(optional.entry, fragment.entry);
+	AddLambdaTransition(optional.entry, fragment.exit);
+
+	return optional;
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Repeat(Fragment const& fragment, uint32 const& minimum, uint32 const& maximum)
+{
+	assert(minimum <= maximum && (minimum < Unbounded));
+
+	if (!maximum)
+		return Empty();
+
+	// Every repetition needs its own states. An unbounded repetition ends with a Plus, or is a Star.
+	FragmentsVector copies(1, fragment);
+	uint32 const count = (maximum == Unbounded) ? std::max(minimum, 1u) : maximum;
+
+	for (uint32 i = 1; i < count; ++i)
+		copies.push_back(Copy(fragment));
+
+	if (maximum == Unbounded)
+	{
+		if (!minimum)
+			return Star(copies.front());
+
+		copies.back() = Plus(copies.back());
+		return Concatenate(copies);
+	}
+
+	// The optional repetitions are nested, (f(f(f)?)?)?, so each one is only reached after the previous one.
+	FragmentsVector required(copies.begin(), copies.begin() + minimum);
+
+	if (maximum > minimum)
+	{
+		Fragment optional = Optional(copies.back());
+
+		for (uint32 i = maximum - 1; i-- > minimum; )
+			optional = Optional(Concatenate(copies[i], optional));
+
+		required.push_back(optional);
+	}
+
+	return Concatenate(required);
+}
+
+AutomataBuilder::Fragment AutomataBuilder::Copy(Fragment const& fragment)
+{
+	StatesVector order;
+	NumberStates(fragment.entry, &order);
+
+	// An automaton without accepted words has its exit out of reach.
+	if (_marks[fragment.exit] != _stamp)
+	{
+		_marks[fragment.exit] = _stamp;
+		_numbering[fragment.exit] = static_cast<uint32>(order.size());
+		order.push_back(fragment.exit);
+	}
+
+	uint32 const offset = GetStatesCount();
+
+	for (uint32 i = 0; i < order.size(); ++i)
+		AddState();
+
+	for (uint32 i = 0; i < order.size(); ++i)
+		for (uint32 edge = _firstEdges[order[i]]; edge != TransitionTable::InvalidState; edge = _edges[edge].next)
+		{
+			Edge const copied = _edges[edge];	// Adding the copy can move the edges.
+
+			if (copied.lambda)
+				AddLambdaTransition(offset + i, offset + _numbering[copied.target]);
+			else
+				AddTransition(offset + i, copied.key, offset + _numbering[copied.target]);
+		}
+
+	return Fragment(offset, offset + _numbering[fragment.exit]);
+}
+
+NFA AutomataBuilder::Build(Fragment const& fragment)
+{
+	LFA_STATISTICS_OPERATION("AutomataBuilder::Build");
+
+	StatesVector order;
+	TransitionsVector transitions, lambdaTransitions;
+	StatesVector finalStates;
+
+	NumberStates(fragment.entry, &order);
+
+	for (uint32 i = 0; i < order.size(); ++i)
+		for (uint32 edge = _firstEdges[order[i]]; edge != TransitionTable::InvalidState; edge = _edges[edge].next)
+			(_edges[edge].lambda ? lambdaTransitions : transitions).emplace_back(TransitionPair(i, _edges[edge].key),
+				_numbering[_edges[edge].target]);
+
+	if (_marks[fragment.exit] == _stamp)
+		finalStates.push_back(_numbering[fragment.exit]);
+
+	uint32 const states = static_cast<uint32>(order.size());
+	Clear();
+
+	return NFA(states, 0, std::move(finalStates), std::move(transitions), std::move(lambdaTransitions));
+}
+
+void AutomataBuilder::Clear()
+{
+	_edges.clear();
+	_firstEdges.clear();
+	_marks.clear();
+	_numbering.clear();
+}
+
+uint32 AutomataBuilder::AddState()
+{
+	assert(GetStatesCount() != TransitionTable::InvalidState);
+
+	_firstEdges.push_back(TransitionTable::InvalidState);
+	return GetStatesCount() - 1;
+}
+
+void AutomataBuilder::AddTransition(uint32 const& state, char const& key, uint32 const& target)
+{
+	_edges.emplace_back(target, _firstEdges[state], key, false);
+	_firstEdges[state] = GetTransitionsCount() - 1;
+}
+
+void AutomataBuilder::AddLambdaTransition(uint32 const& state, uint32 const& target)
+{
+	_edges.emplace_back(target, _firstEdges[state], FiniteAutomata::Lambda, true);
+	_firstEdges[state] = GetTransitionsCount() - 1;
+}
+
+void AutomataBuilder::NumberStates(uint32 const& state, StatesVector* order)
+{
+	Stack<uint32> stack;
+
+	// Cleared marks are 0, so the stamp skips it.
+	if (!++_stamp)
+		++_stamp;
+
+	_marks.resize(GetStatesCount(), 0);
+	_numbering.resize(GetStatesCount());
+	order->clear();
+
+	_marks[state] = _stamp;
+	_numbering[state] = 0;
+	order->push_back(state);
+	stack.push(state);
+
+	while (!stack.empty())
+	{
+		uint32 const current = stack.top();
+		stack.pop();
+
+		for (uint32 edge = _firstEdges[current]; edge != TransitionTable::InvalidState; edge = _edges[edge].next)
+		{
+			uint32 const target = _edges[edge].target;
+
+			if (_marks[target] != _stamp)
+			{
+				_marks[target] = _stamp;
+				_numbering[target] = static_cast<uint32>(order->size());
+				order->push_back(target);
+				stack.push(target);
+			}
+		}
+	}
+}
+
@@ -0,0 +1,92 @@
+#ifndef LFA_LIB_AUTOMATA_BUILDER_H
+#define LFA_LIB_AUTOMATA_BUILDER_H
+
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "NondeterministicFiniteAutomata.h"
+
+// Builds an NFA from smaller ones with Thompson's construction, without copying them.
+// Every state and transition goes to one arena, the combinators only append the few states
+// and lambda transitions joining their operands, so building costs the size of the result.
+// A fragment has one entry and one exit state and no transition leaves its exit.
+// Fragments passed to a combinator are consumed by it, Copy gives a fragment to pass again.
+class AutomataBuilder
+{
+	public:
+		struct Fragment
+		{
+			uint32 entry;
+			uint32 exit;
+
+			Fragment() : entry(0), exit(0) { }
+			Fragment(uint32 const& entry, uint32 const& exit) : entry(entry), exit(exit) { }
+		};
+
+		typedef Vector<Fragment> FragmentsVector;
+
+		static uint32 const Unbounded = 0xFFFFFFFF;
+
+		AutomataBuilder() : _stamp(0) { }
+
+		// Every symbol stands for itself, Lambda included, the lambda transitions are kept apart.
+		Fragment Empty();	// Accepts the empty word.
+		Fragment Symbol(char const& key);
+		Fragment Word(String const& word);
+
+		// The states of automaton are appended with their ids offset.
+		Fragment Append(FiniteAutomata const& automaton);
+
+		Fragment Union(Fragment const& first, Fragment const& second);
+		Fragment Union(FragmentsVector const& fragments);	// Not empty.
+		Fragment Concatenate(Fragment const& first, Fragment const& second);
+		Fragment Concatenate(FragmentsVector const& fragments);	// Not empty.
+		Fragment Star(Fragment const& fragment);
+		Fragment Plus(Fragment const& fragment);
+		Fragment Optional(Fragment const& fragment);
+
+		// From minimum to maximum, possibly Unbounded, repetitions. The copies are made with Copy.
+		Fragment Repeat(Fragment const& fragment, uint32 const& minimum, uint32 const& maximum);
+
+		// Appends the states of fragment again, in time proportional to them.
+		Fragment Copy(Fragment const& fragment);
+
+		uint32 GetStatesCount() const { return static_cast<uint32>(_firstEdges.size()); }
+		uint32 GetTransitionsCount() const { return static_cast<uint32>(_edges.size()); }
+
+		// Returns the NFA of the states reachable from the entry of fragment and clears the builder.
+		// States are numbered in the order a depth-first search from the entry finds them, the entry is 0.
+		NFA Build(Fragment const& fragment);
+
+		void Clear();
+
+	private:
+		struct Edge
+		{
+			uint32 target;
+			uint32 next;	// Next edge of the same state, TransitionTable::InvalidState after the last one.
+			char key;
+			bool lambda;	// A lambda transition, key is Lambda then.
+
+			Edge(uint32 const& target, uint32 const& next, char const& key, bool const& lambda) : 
+				target(target), next(next), key(key), lambda(lambda) { }
+		};
+
+		Vector<Edge> _edges;
+		StatesVector _firstEdges;	// Of every state, edges are listed from the last one added.
+
+		// Copy and Build scratch, _marks[state] == _stamp tells _numbering[state] is set.
+		StatesVector _marks;
+		StatesVector _numbering;
+		uint32 _stamp;
+
+		uint32 AddState();
+		void AddTransition(uint32 const& state, char const& key, uint32 const& target);
+		void AddLambdaTransition(uint32 const& state, uint32 const& target);
+
+		// Numbers the states reachable from state in the order a depth-first search finds them,
+		// (*order)[i] is the state numbered i.
+		void NumberStates(uint32 const& state, StatesVector* order);
+};
+
+#endif
+
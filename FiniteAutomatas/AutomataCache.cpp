@@ -0,0 +1,105 @@
+#include "PCH.h"
+#include "AutomataCache.h"
+
+DFA AutomataCache::ToDFA(NFA const& nfa)
+{
+	uint64 const fingerprint = nfa.GetFingerprint();
+	DFA dfa;
+
+	if (Find(fingerprint, OPERATION_TO_DFA, &dfa))
+		return dfa;
+
+	dfa = nfa.ToDFA();
+	Store(fingerprint, OPERATION_TO_DFA, dfa);
+
+	return dfa;
+}
+
+DFA AutomataCache::GetMinimalDFA(FiniteAutomata const& automaton)
+{
+	uint64 const fingerprint = automaton.GetFingerprint();
+	DFA dfa;
+
+	if (Find(fingerprint, OPERATION_MINIMIZE, &dfa))
+		return dfa;
+
+	dfa = automaton.GetMinimalDFA();
+	Store(fingerprint, OPERATION_MINIMIZE, dfa);
+
+	return dfa;
+}
+
+void AutomataCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_automata.clear();
+}
+
+bool AutomataCache::Find(uint64 const& fingerprint, Operation const& operation, DFA* dfa)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	Map<Pair<uint64, Operation>, DFA>::const_iterator itr = _automata.find(std::make_pair(fingerprint, operation));
+
+	if (itr != _automata.end())
+	{
+		*dfa = itr->second;
+		++_hits;
+		return true;
+	}
+
+	// A file which cannot be read, truncated or of another format, is a miss and is replaced by Store.
+	if (!_directory.empty())
+	{
+		std::ifstream ifs(GetPath(fingerprint, operation), std::ios::binary);
+
+		if (ifs.is_open() && DFA::ReadBinary(ifs, dfa))
+		{
+			_automata.emplace(std::make_pair(fingerprint, operation), *dfa);
+			++_hits;
+			return true;
+		}
+	}
+
+	++_misses;
+	return false;
+}
+
+void AutomataCache::Store(uint64 const& fingerprint, Operation const& operation, DFA const& dfa)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_automata.emplace(std::make_pair(fingerprint, operation), dfa);
+
+	if (_directory.empty())
+		return;
+
+	// Write to a temporary file first so a reader never sees half a file. Its name is unique to this
+	// write, other caches and other processes may be storing the same result in the directory.
+	static std::atomic<uint32> writes(0);
+	String const path = GetPath(fingerprint, operation);
+	String const temporaryPath = path + "." + std::to_string(std::random_device()()) + "-" +
+		std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-" + std::to_string(writes++) + ".tmp";
+	bool written;
+
+	{
+		std::ofstream ofs(temporaryPath, std::ios::binary);
+
+		if (!ofs.is_open())
+			return;
+
+		dfa.WriteBinary(ofs);
+		ofs.close();
+		written = static_cast<bool>(ofs);
+	}
+
+	if (!written || std::rename(temporaryPath.c_str(), path.c_str()))
+		std::remove(temporaryPath.c_str());
+}
+
+String AutomataCache::GetPath(uint64 const& fingerprint, Operation const& operation) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(fingerprint));
+
+	return _directory + "/" + name + ((operation == OPERATION_TO_DFA) ? ".dfa" : ".min.dfa");
+}
+
@@ -0,0 +1,45 @@
+#ifndef LFA_LIB_AUTOMATA_CACHE_H
+#define LFA_LIB_AUTOMATA_CACHE_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+#include "NondeterministicFiniteAutomata.h"
+
+// Cache of ToDFA and GetMinimalDFA results keyed by the fingerprint of the source automaton.
+// Results are kept in memory and, when a directory is given, written there in the binary format
+// of DFA::WriteBinary so they survive restarts. A file which cannot be read back is a miss.
+// Fingerprints are 64 bit hashes and are trusted as keys.
+class AutomataCache
+{
+	public:
+		explicit AutomataCache(String const& directory = String()) : _directory(directory), _hits(0), _misses(0) { }
+
+		DFA ToDFA(NFA const& nfa);
+		DFA GetMinimalDFA(FiniteAutomata const& automaton);
+
+		void Clear();	// Forgets the results kept in memory, files are kept.
+
+		uint64 GetHits() const { return _hits; }
+		uint64 GetMisses() const { return _misses; }
+
+	private:
+		enum Operation
+		{
+			OPERATION_TO_DFA,
+			OPERATION_MINIMIZE
+		};
+
+		std::mutex _mutex;
+		String _directory;
+		Map<Pair<uint64, Operation>, DFA> _automata;
+		uint64 _hits;
+		uint64 _misses;
+
+		bool Find(uint64 const& fingerprint, Operation const& operation, DFA* dfa);
+		void Store(uint64 const& fingerprint, Operation const& operation, DFA const& dfa);
+
+		String GetPath(uint64 const& fingerprint, Operation const& operation) const;
+};
+
+#endif
+
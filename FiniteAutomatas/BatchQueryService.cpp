@@ -0,0 +1,134 @@
+#include "PCH.h"
+#include "BatchQueryService.h"
+#include "Statistics.h"
+
+BatchQueryService::BatchQueryService(uint32 threads) : _batch(0), _running(0), _stop(false), _queries(nullptr), _results(nullptr)
+{
+	if (!threads)
+		threads = std::max(std::thread::hardware_concurrency(), 1U);
+
+	for (uint32 i = 0; i < threads; ++i)
+		_workers.emplace_back(new Worker());
+
+	for (uint32 i = 0; i < threads; ++i)
+		_workers[i]->thread = std::thread(&BatchQueryService::Work, this, i);
+}
+
+BatchQueryService::~BatchQueryService()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+
+	_start.notify_all();
+
+	for (uint32 i = 0; i < _workers.size(); ++i)
+		_workers[i]->thread.join();
+}
+
+Vector<bool> BatchQueryService::Run(BatchQueriesVector const& queries)
+{
+	if (queries.empty())
+		return Vector<bool>();
+
+	LFA_STATISTICS_OPERATION("BatchQueryService::Run");
+
+	std::lock_guard<std::mutex> runLock(_runMutex);
+	Vector<uint8> results(queries.size(), 0);
+
+	// Consecutive chunks go to different workers, so expensive stretches of the batch are split from the start.
+	uint32 const size = static_cast<uint32>(queries.size());
+
+	for (uint32 first = 0, worker = 0; first < size; first += ChunkSize, worker = (worker + 1) % _workers.size())
+	{
+		std::lock_guard<std::mutex> lock(_workers[worker]->mutex);
+		_workers[worker]->ranges.emplace_back(first, std::min(first + ChunkSize, size));
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_queries = &queries;
+		_results = &results;
+		_running = static_cast<uint32>(_workers.size());
+		++_batch;
+
+		_start.notify_all();
+		_done.wait(lock, [this]() { return !_running; });
+
+		_queries = nullptr;
+		_results = nullptr;
+	}
+
+	return Vector<bool>(results.begin(), results.end());
+}
+
+bool BatchQueryService::Pop(uint32 const& worker, QueryRange* range)
+{
+	{
+		Worker& own = *_workers[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+
+		if (!own.ranges.empty())
+		{
+			*range = own.ranges.back();
+			own.ranges.pop_back();
+			return true;
+		}
+	}
+
+	for (uint32 i = 1; i < _workers.size(); ++i)
+	{
+		Worker& victim = *_workers[(worker + i) % _workers.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+
+		if (!victim.ranges.empty())
+		{
+			*range = victim.ranges.front();
+			victim.ranges.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BatchQueryService::Work(uint32 const& worker)
+{
+	uint64 batch = 0;
+	CompiledAutomata::Scratch& scratch = _workers[worker]->scratch;
+
+	while (true)
+	{
+		BatchQueriesVector const* queries;
+		Vector<uint8>* results;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_start.wait(lock, [this, batch]() { return _stop || _batch != batch; });
+
+			if (_stop)
+				return;
+
+			batch = _batch;
+			queries = _queries;
+			results = _results;
+		}
+
+		// Every chunk is queued before the batch starts, so empty queues mean the batch is done.
+		QueryRange range;
+
+		while (Pop(worker, &range))
+			for (uint32 i = range.first; i < range.second; ++i)
+			{
+				BatchQuery const& query = (*queries)[i];
+				(*results)[i] = (query.automaton && query.automaton->IsAccepted(query.word, &scratch)) ? 1 : 0;
+			}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (!--_running)
+			_done.notify_one();
+	}
+}
+
@@ -0,0 +1,63 @@
+#ifndef LFA_LIB_BATCH_QUERY_SERVICE_H
+#define LFA_LIB_BATCH_QUERY_SERVICE_H
+
+#include "PCH.h"
+#include "CompiledAutomata.h"
+
+struct BatchQuery
+{
+	CompiledAutomataPtr automaton;
+	String word;
+
+	BatchQuery() { }
+	BatchQuery(CompiledAutomataPtr const& automaton, String const& word) : automaton(automaton), word(word) { }
+};
+
+typedef Vector<BatchQuery> BatchQueriesVector;
+
+// Answers batches of queries on a pool of threads started once by the constructor.
+// A batch is cut in chunks spread over the queues of the workers. A worker takes chunks from the back
+// of its own queue and steals from the front of the other queues once it runs dry.
+// The automata are shared, every worker only owns its CompiledAutomata::Scratch.
+class BatchQueryService
+{
+	public:
+		static uint32 const ChunkSize = 64;	// Queries per chunk.
+
+		explicit BatchQueryService(uint32 threads = 0);	// 0 uses every hardware thread.
+		~BatchQueryService();
+
+		uint32 GetThreadsCount() const { return static_cast<uint32>(_workers.size()); }
+
+		// result[i] tells whether queries[i].word is accepted. Concurrent calls run one after the other.
+		Vector<bool> Run(BatchQueriesVector const& queries);
+
+	private:
+		typedef Pair<uint32, uint32> QueryRange;	// [first, second) in the batch.
+
+		struct Worker
+		{
+			std::mutex mutex;
+			std::deque<QueryRange> ranges;
+			CompiledAutomata::Scratch scratch;
+			std::thread thread;
+		};
+
+		Vector<std::unique_ptr<Worker>> _workers;
+
+		std::mutex _runMutex;	// Held for a whole batch.
+		std::mutex _mutex;		// Guards the members below.
+		std::condition_variable _start, _done;
+		uint64 _batch;			// Incremented for every batch, the workers wait for it to change.
+		uint32 _running;		// Workers still busy with the current batch.
+		bool _stop;
+
+		BatchQueriesVector const* _queries;
+		Vector<uint8>* _results;	// Not Vector<bool>, its elements cannot be written concurrently.
+
+		bool Pop(uint32 const& worker, QueryRange* range);
+		void Work(uint32 const& worker);
+};
+
+#endif
+
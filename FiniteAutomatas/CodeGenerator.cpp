@@ -0,0 +1,179 @@
+#include "PCH.h"
+#include "CodeGenerator.h"
+#include "TransitionTable.h"
+
+namespace
+{
+	bool IsIdentifier(String const& name)
+	{
+		if (name.empty() || isdigit(static_cast<uint8>(name[0])))
+			return false;
+
+		for (String::const_iterator itr = name.begin(); itr != name.end(); ++itr)
+			if (!isalnum(static_cast<uint8>(*itr)) && (*itr) != '_')
+				return false;
+
+		return true;
+	}
+
+	String ToUpper(String name)
+	{
+		std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(toupper(static_cast<uint8>(c))); });
+		return name;
+	}
+
+	// Targets of the 256 bytes from state under numbering, dead for the missing transitions.
+	StatesVector GetRow(TransitionTable const& table, StatesVector const& numbering, uint32 const& state, uint32 const& dead)
+	{
+		StatesVector row(256, dead);
+
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			row[static_cast<uint8>(table.GetSymbol(edge))] = numbering[*table.GetTargets(edge).first];
+
+		return row;
+	}
+}
+
+void CodeGenerator::Write(DFA const& dfa, String const& name, Style const& style, std::ofstream& ofs)
+{
+	assert(IsIdentifier(name));
+
+	StatesVector numbering = dfa.GetBreadthFirstNumbering();
+	uint32 states = 0;
+
+	for (StatesConstIterator itr = numbering.begin(); itr != numbering.end(); ++itr)
+		if ((*itr) != TransitionTable::InvalidState)
+			states = std::max(states, (*itr) + 1);
+
+	String const guard = "LFA_GENERATED_" + ToUpper(name) + "_H";
+
+	ofs << "// Generated from a DFA with " << states << " reachable states, do not edit.\n";
+	ofs << "#ifndef " << guard << "\n#define " << guard << "\n\n";
+	ofs << "#include <cstddef>\n#include <cstdint>\n\n";
+	ofs << "namespace " << name << "\n{\n";
+
+	if (style == STYLE_TABLE)
+		WriteTable(dfa, numbering, states, ofs);
+	else
+		WriteSwitch(dfa, numbering, states, ofs);
+
+	ofs << "}\n\n#endif\n";
+}
+
+void CodeGenerator::WriteTable(DFA const& dfa, StatesVector const& numbering, uint32 const& states, std::ofstream& ofs)
+{
+	TransitionTable const& table = dfa.GetTransitionTable();
+	StatesSet const finalStates = dfa.GetFinalStates();
+	uint32 const dead = states;	// The extra row, every byte leads back to it.
+	char const* type = (states < (1 << 8)) ? "std::uint8_t" : (states < (1 << 16)) ? "std::uint16_t" : "std::uint32_t";
+	Vector<StatesVector> rows(states + 1);
+	Vector<bool> finals(states + 1, false);
+
+	for (uint32 state = 0; state < numbering.size(); ++state)
+		if (numbering[state] != TransitionTable::InvalidState)
+		{
+			rows[numbering[state]] = GetRow(table, numbering, state, dead);
+			finals[numbering[state]] = finalStates.count(state) != 0;
+		}
+
+	rows[dead].assign(256, dead);
+
+	ofs << "\tstatic constexpr " << type << " Next[" << (states + 1) << "][256] =\n\t{\n";
+
+	for (uint32 state = 0; state <= states; ++state)
+	{
+		ofs << "\t\t{";
+
+		for (uint32 key = 0; key < 256; ++key)
+			ofs << ((key % 32) ? " " : "\n\t\t\t") << rows[state][key] << ((key != 255) ? "," : "");
+
+		ofs << "\n\t\t}" << ((state != states) ? "," : "") << "\n";
+	}
+
+	ofs << "\t};\n\n\tstatic constexpr bool Final[" << (states + 1) << "] =\n\t{";
+
+	for (uint32 state = 0; state <= states; ++state)
+		ofs << ((state % 16) ? " " : "\n\t\t") << (finals[state] ? "true" : "false") << ((state != states) ? "," : "");
+
+	ofs << "\n\t};\n\n";
+	ofs << "\ttemplate <typename Iterator>\n\tbool IsAccepted(Iterator first, Iterator last)\n\t{\n";
+	ofs << "\t\tstd::size_t state = 0;\n\n";
+	ofs << "\t\tfor (; first != last; ++first)\n";
+	ofs << "\t\t\tstate = Next[state][static_cast<unsigned char>(*first)];\n\n";
+	ofs << "\t\treturn Final[state];\n\t}\n\n";
+	ofs << "\tconstexpr bool IsAccepted(char const* word, std::size_t length)\n\t{\n";
+	ofs << "\t\tstd::size_t state = 0;\n\n";
+	ofs << "\t\tfor (std::size_t i = 0; i < length; ++i)\n";
+	ofs << "\t\t\tstate = Next[state][static_cast<unsigned char>(word[i])];\n\n";
+	ofs << "\t\treturn Final[state];\n\t}\n";
+}
+
+void CodeGenerator::WriteSwitch(DFA const& dfa, StatesVector const& numbering, uint32 const& states, std::ofstream& ofs)
+{
+	TransitionTable const& table = dfa.GetTransitionTable();
+	StatesSet const finalStates = dfa.GetFinalStates();
+	StatesVector original(states);
+	Vector<StatesVector> rows(states);
+	Vector<bool> targeted(states, false);
+
+	for (uint32 state = 0; state < numbering.size(); ++state)
+		if (numbering[state] != TransitionTable::InvalidState)
+			original[numbering[state]] = state;
+
+	for (uint32 state = 0; state < states; ++state)
+	{
+		rows[state] = GetRow(table, numbering, original[state], TransitionTable::InvalidState);
+
+		for (StatesConstIterator itr = rows[state].begin(); itr != rows[state].end(); ++itr)
+			if ((*itr) != TransitionTable::InvalidState)
+				targeted[*itr] = true;
+	}
+
+	ofs << "\ttemplate <typename Iterator>\n\tbool IsAccepted(Iterator first, Iterator last)\n\t{\n";
+
+	if (!states)
+		ofs << "\t\treturn false;\n";
+
+	// The initial state is entered by falling into it, so its label is only written when a goto needs it.
+	for (uint32 state = 0; state < states; ++state)
+	{
+		bool const final = finalStates.count(original[state]) != 0;
+		StatesVector const& row = rows[state];
+
+		if (state != 0)
+			ofs << "\n";
+
+		if (targeted[state])
+			ofs << "\tstate_" << state << ":\n";
+
+		ofs << "\t\tif (first == last)\n\t\t\treturn " << (final ? "true" : "false") << ";\n\n";
+		ofs << "\t\tswitch (static_cast<unsigned char>(*first++))\n\t\t{\n";
+
+		// One group of case labels per target, in the order of the first byte leading to it.
+		Vector<bool> written(256, false);
+
+		for (uint32 key = 0; key < 256; ++key)
+		{
+			if (written[key] || row[key] == TransitionTable::InvalidState)
+				continue;
+
+			ofs << "\t\t\t";
+
+			for (uint32 other = key; other < 256; ++other)
+				if (row[other] == row[key])
+				{
+					written[other] = true;
+					ofs << "case " << other << ": ";
+				}
+
+			ofs << "goto state_" << row[key] << ";\n";
+		}
+
+		ofs << "\t\t\tdefault: return false;\n\t\t}\n";
+	}
+
+	ofs << "\t}\n\n";
+	ofs << "\tinline bool IsAccepted(char const* word, std::size_t length)\n\t{\n";
+	ofs << "\t\treturn IsAccepted(word, word + length);\n\t}\n";
+}
+
@@ -0,0 +1,33 @@
+#ifndef LFA_LIB_CODE_GENERATOR_H
+#define LFA_LIB_CODE_GENERATOR_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+
+// Writes a DFA as a standalone C++14 header, so a fixed pattern is matched by code the compiler
+// sees whole instead of a table loaded at runtime. The header defines in namespace name
+//	template <typename Iterator> bool IsAccepted(Iterator first, Iterator last);
+//	bool IsAccepted(char const* word, std::size_t length);
+// STYLE_TABLE emits a constexpr dense table, with a dead row for the missing transitions,
+// and the pointer overload is constexpr. STYLE_SWITCH emits one block per state, labeled when
+// a transition enters it, with a switch on the next byte jumping to the label of the target.
+// Only the reachable states are written, numbered in breadth-first order.
+class CodeGenerator
+{
+	public:
+		enum Style
+		{
+			STYLE_TABLE,
+			STYLE_SWITCH
+		};
+
+		// name is used for the namespace and the include guard, so it has to be a C++ identifier.
+		static void Write(DFA const& dfa, String const& name, Style const& style, std::ofstream& ofs);
+
+	private:
+		static void WriteTable(DFA const& dfa, StatesVector const& numbering, uint32 const& states, std::ofstream& ofs);
+		static void WriteSwitch(DFA const& dfa, StatesVector const& numbering, uint32 const& states, std::ofstream& ofs);
+};
+
+#endif
+
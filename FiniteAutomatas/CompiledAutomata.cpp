@@ -0,0 +1,96 @@
+#include "PCH.h"
+#include "CompiledAutomata.h"
+#include "DeterministicFiniteAutomata.h"
+
+CompiledAutomataPtr CompiledAutomata::Compile(FiniteAutomata const& automaton)
+{
+	return CompiledAutomataPtr(new CompiledAutomata(automaton));
+}
+
+CompiledAutomata::CompiledAutomata(FiniteAutomata const& automaton) : _initialState(automaton.GetInitialState()),
+	_lambda(automaton.HasLambdaTransitions())
+{
+	if (!automaton.HasStates())
+		return;
+
+	_table = automaton.GetTransitionTable();
+	_lambdaTable = automaton.GetLambdaTable();
+	_finalStates.assign(std::max(_table.GetStates(), automaton.GetStatesCount()), false);
+
+	StatesSet const finalStates = automaton.GetFinalStates();
+
+	for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		if ((*itr) < _finalStates.size())
+			_finalStates[*itr] = true;
+
+	// An NFA without lambda transitions and with a single target per transition is compiled as a DFA.
+	if (!_lambda && _table.IsDeterministic())
+	{
+		_dfa.reset(new CompressedTable(DFA(automaton.GetStatesCount(), _initialState,
+			StatesVector(finalStates.begin(), finalStates.end()), std::move(_table))));
+		_table = TransitionTable();
+	}
+}
+
+bool CompiledAutomata::IsAccepted(String const& word, Scratch* scratch) const
+{
+	if (_finalStates.empty())
+		return false;
+
+	if (_dfa)
+		return _dfa->IsAccepted(word);
+
+	uint32 stamp = GetStamp(scratch);
+	StatesVector& current = scratch->current;
+	StatesVector& next = scratch->next;
+
+	current.assign(1, _initialState);
+	scratch->marks[_initialState] = stamp;
+
+	if (_lambda)
+		_lambdaTable.AddClosure(FiniteAutomata::Lambda, &current, &scratch->marks, stamp);
+
+	for (String::const_iterator itr = word.begin(); itr != word.end(); ++itr)
+	{
+		stamp = GetStamp(scratch);
+		next.clear();
+		_table.AddTargets(current, *itr, &next, &scratch->marks, stamp);
+
+		if (next.empty())
+			return false;
+
+		if (_lambda)
+			_lambdaTable.AddClosure(FiniteAutomata::Lambda, &next, &scratch->marks, stamp);
+
+		current.swap(next);
+	}
+
+	for (StatesConstIterator itr = current.begin(); itr != current.end(); ++itr)
+		if (_finalStates[*itr])
+			return true;
+
+	return false;
+}
+
+bool CompiledAutomata::IsAccepted(String const& word) const
+{
+	Scratch scratch;
+
+	return IsAccepted(word, &scratch);
+}
+
+uint32 CompiledAutomata::GetStamp(Scratch* scratch) const
+{
+	// Stamps only grow, so marks left by another automaton never look current.
+	if (scratch->marks.size() < _finalStates.size())
+		scratch->marks.resize(_finalStates.size(), TransitionTable::InvalidState);
+
+	if (++scratch->stamp == TransitionTable::InvalidState)
+	{
+		std::fill(scratch->marks.begin(), scratch->marks.end(), TransitionTable::InvalidState);
+		scratch->stamp = 0;
+	}
+
+	return scratch->stamp;
+}
+
@@ -0,0 +1,53 @@
+#ifndef LFA_LIB_COMPILED_AUTOMATA_H
+#define LFA_LIB_COMPILED_AUTOMATA_H
+
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "TransitionTable.h"
+#include "CompressedTable.h"
+
+class CompiledAutomata;
+
+typedef std::shared_ptr<CompiledAutomata const> CompiledAutomataPtr;
+
+// Frozen copy of an automaton which is safe to share between threads.
+// Nothing changes after Compile, so any number of threads can query the same instance.
+// Deterministic automata are kept as a CompressedTable, the others as a TransitionTable
+// and a final states bitmap. What a query needs to write lives in a Scratch owned by the caller.
+class CompiledAutomata
+{
+	public:
+		// Per thread buffers for the queries, reusable across automata.
+		struct Scratch
+		{
+			StatesVector current, next, marks;
+			uint32 stamp;
+
+			Scratch() : stamp(0) { }
+		};
+
+		static CompiledAutomataPtr Compile(FiniteAutomata const& automaton);
+
+		bool IsDeterministic() const { return _dfa.get() != nullptr; }
+		uint32 GetStatesCount() const { return static_cast<uint32>(_finalStates.size()); }
+
+		bool IsAccepted(String const& word, Scratch* scratch) const;
+		bool IsAccepted(String const& word) const;	// Uses a temporary Scratch.
+
+	private:
+		std::unique_ptr<CompressedTable const> _dfa;
+
+		// Used when the automaton is not deterministic.
+		TransitionTable _table;
+		TransitionTable _lambdaTable;
+		uint32 _initialState;
+		Vector<bool> _finalStates;
+		bool _lambda;	// Has lambda transitions.
+
+		explicit CompiledAutomata(FiniteAutomata const& automaton);
+
+		uint32 GetStamp(Scratch* scratch) const;
+};
+
+#endif
+
@@ -0,0 +1,187 @@
+#include "PCH.h"
+#include "CompressedTable.h"
+#include "Statistics.h"
+
+namespace
+{
+	typedef Vector<Pair<uint8, uint32>> RowVector;	// (byte, target), sorted by byte.
+
+	// Holes further than this behind the end of the packed arrays are not tried anymore,
+	// otherwise every row would test all the holes no row could fill so far.
+	uint32 const SearchWindow = 1 << 12;
+
+	// Free slots of the packed arrays. A used slot points to a slot further right,
+	// so Find skips runs of used slots at once.
+	class FreeSlots
+	{
+		public:
+			bool IsFree(uint32 const& slot) const { return slot >= _next.size() || _next[slot] == slot; }
+
+			uint32 Find(uint32 slot)	// First free slot from slot on.
+			{
+				while (slot < _next.size() && _next[slot] != slot)
+				{
+					uint32 next = _next[slot];
+
+					if (next < _next.size())
+						_next[slot] = _next[next];
+
+					slot = next;
+				}
+
+				return slot;
+			}
+
+			void Use(uint32 const& slot)
+			{
+				while (_next.size() <= slot)
+					_next.push_back(static_cast<uint32>(_next.size()));
+
+				_next[slot] = slot + 1;
+			}
+
+		private:
+			StatesVector _next;
+	};
+
+	// Picks the most common target of the 256 bytes, the dead state included, and
+	// returns the transitions left to store.
+	uint32 SplitRow(TransitionTable const& table, uint32 const& state, RowVector* row)
+	{
+		uint32 const edges = table.GetEdgesEnd(state) - table.GetEdgesBegin(state);
+		StatesVector targets;
+
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			targets.push_back(*table.GetTargets(edge).first);
+
+		std::sort(targets.begin(), targets.end());
+
+		uint32 defaultTarget = TransitionTable::InvalidState;
+		uint32 defaultCount = 256 - edges;
+
+		for (uint32 i = 0, j = 0; i < targets.size(); i = j)
+		{
+			while (j < targets.size() && targets[j] == targets[i])
+				++j;
+
+			if (j - i > defaultCount)
+			{
+				defaultTarget = targets[i];
+				defaultCount = j - i;
+			}
+		}
+
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			if (*table.GetTargets(edge).first != defaultTarget)
+				row->emplace_back(static_cast<uint8>(table.GetSymbol(edge)), *table.GetTargets(edge).first);
+
+		std::sort(row->begin(), row->end());
+
+		return defaultTarget;
+	}
+}
+
+CompressedTable::CompressedTable(DFA const& dfa) : _initialState(TransitionTable::InvalidState)
+{
+	LFA_STATISTICS_OPERATION("CompressedTable::Build");
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	TransitionTable const& table = dfa.GetTransitionTable();
+	StatesSet const finalStates = dfa.GetFinalStates();
+	uint32 const states = table.GetStates();
+
+	memset(&_statistics, 0, sizeof(_statistics));
+
+	if (dfa.HasStates())
+		_initialState = dfa.GetInitialState();
+
+	_finalStates.assign(std::max(states, 1u), false);
+
+	for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		if ((*itr) < states)
+			_finalStates[*itr] = true;
+
+	Vector<RowVector> rows(states);
+	StatesVector order(states);
+
+	_default.resize(states);
+	_base.assign(states, 0);
+
+	for (uint32 state = 0; state < states; ++state)
+	{
+		_default[state] = SplitRow(table, state, &rows[state]);
+		_statistics.entries += static_cast<uint32>(rows[state].size());
+		order[state] = state;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&rows](uint32 const& first, uint32 const& second)
+	{
+		return rows[first].size() > rows[second].size();
+	});
+
+	// First fit: a row goes at the lowest base where its bytes only fall on free slots.
+	FreeSlots freeSlots;
+	uint32 slots = 0;
+
+	for (StatesConstIterator itr = order.begin(); itr != order.end() && !rows[*itr].empty(); ++itr)
+	{
+		RowVector const& row = rows[*itr];
+		uint32 base = 0;
+		uint32 lowest = slots > SearchWindow ? slots - SearchWindow : 0;
+
+		for (uint32 slot = freeSlots.Find(std::max<uint32>(lowest, row.front().first)); ; slot = freeSlots.Find(slot + 1))
+		{
+			base = slot - row.front().first;
+			bool fits = true;
+
+			for (RowVector::const_iterator iter = row.begin() + 1; iter != row.end() && fits; ++iter)
+				fits = freeSlots.IsFree(base + iter->first);
+
+			if (fits)
+				break;
+		}
+
+		_base[*itr] = base;
+		slots = std::max(slots, base + row.back().first + 1);
+
+		for (RowVector::const_iterator iter = row.begin(); iter != row.end(); ++iter)
+			freeSlots.Use(base + iter->first);
+	}
+
+	// Padding so that _base[state] + byte never reads past the arrays.
+	uint32 size = 256;
+
+	for (uint32 state = 0; state < states; ++state)
+		size = std::max(size, _base[state] + 256);
+
+	_next.assign(size, TransitionTable::InvalidState);
+	_check.assign(size, TransitionTable::InvalidState);
+
+	for (uint32 state = 0; state < states; ++state)
+		for (RowVector::const_iterator itr = rows[state].begin(); itr != rows[state].end(); ++itr)
+		{
+			_next[_base[state] + itr->first] = itr->second;
+			_check[_base[state] + itr->first] = state;
+		}
+
+	_statistics.states = states;
+	_statistics.transitions = table.GetTransitionsCount();
+	_statistics.slots = slots;
+	_statistics.memoryUsage = sizeof(uint32) * (_base.size() + _default.size() + _next.size() + _check.size()) +
+		_finalStates.size() / 8;
+	_statistics.denseMemoryUsage = sizeof(uint32) * 256 * static_cast<uint64>(states);
+	_statistics.sparseMemoryUsage = table.GetMemoryUsage();
+	_statistics.buildDuration = static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count());
+}
+
+bool CompressedTable::IsAccepted(String const& word) const
+{
+	uint32 state = _initialState;
+
+	for (String::const_iterator itr = word.begin(); itr != word.end() && state != TransitionTable::InvalidState; ++itr)
+		state = GetNextState(state, static_cast<uint8>(*itr));
+
+	return IsFinalState(state);
+}
+
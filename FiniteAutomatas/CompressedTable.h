@@ -0,0 +1,60 @@
+#ifndef LFA_LIB_COMPRESSED_TABLE_H
+#define LFA_LIB_COMPRESSED_TABLE_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+#include "TransitionTable.h"
+
+struct CompressedTableStatistics
+{
+	uint32 states;
+	uint32 transitions;			// Transitions of the DFA, those to the dead state excluded.
+	uint32 entries;				// Transitions kept in the packed arrays, the others use the default.
+	uint32 slots;				// Length of the packed arrays.
+	uint64 memoryUsage;			// Bytes used by every array.
+	uint64 denseMemoryUsage;	// Bytes a states x 256 table would use.
+	uint64 sparseMemoryUsage;	// Bytes the TransitionTable of the DFA uses.
+	uint64 buildDuration;		// Microseconds
+
+	double GetFillRatio() const { return slots ? static_cast<double>(entries) / slots : 0.0; }
+};
+
+// Compiled DFA transitions packed by row displacement, as in classic scanner generators.
+// Every state has a default target, the most common one over the 256 bytes. The other
+// transitions of a state are kept at _next[_base[state] + byte] and _check tells which state
+// owns a slot, so the rows can be interleaved in the same arrays. A lookup is two array reads.
+// Rows are placed first fit, the fullest first, so memory stays close to the non default edges.
+class CompressedTable
+{
+	public:
+		explicit CompressedTable(DFA const& dfa);
+
+		uint32 GetInitialState() const { return _initialState; }
+		bool IsFinalState(uint32 const& state) const { return state != TransitionTable::InvalidState && _finalStates[state]; }
+
+		// TransitionTable::InvalidState is the dead state and leads to itself.
+		uint32 GetNextState(uint32 const& state, uint8 const& key) const
+		{
+			if (state == TransitionTable::InvalidState)
+				return TransitionTable::InvalidState;
+
+			uint32 slot = _base[state] + key;
+			return _check[slot] == state ? _next[slot] : _default[state];
+		}
+
+		bool IsAccepted(String const& word) const;
+
+		CompressedTableStatistics const& GetStatistics() const { return _statistics; }
+
+	private:
+		uint32 _initialState;
+		Vector<bool> _finalStates;
+		StatesVector _base;
+		StatesVector _default;
+		StatesVector _next;
+		StatesVector _check;
+		CompressedTableStatistics _statistics;
+};
+
+#endif
+
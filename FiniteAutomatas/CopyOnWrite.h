@@ -0,0 +1,59 @@
+#ifndef LFA_LIB_COPY_ON_WRITE_H
+#define LFA_LIB_COPY_ON_WRITE_H
+
+#include "PCH.h"
+
+// Value shared between copies until one of them writes to it.
+// Copies only share a reference counted pointer, so they cost O(1). GetMutable clones
+// the value first if another copy still uses it, the value itself is never changed while shared.
+// An empty pointer stands for a default value, so default construction and moved from copies allocate nothing.
+// Like any value, one CopyOnWrite is not safe to write from a thread while others use it,
+// but distinct copies of the same value can be read and written from different threads.
+template <typename T>
+class CopyOnWrite
+{
+	public:
+		CopyOnWrite() { }
+		CopyOnWrite(T const& value) : _value(std::make_shared<T>(value)) { }
+		CopyOnWrite(T&& value) : _value(std::make_shared<T>(std::move(value))) { }
+
+		CopyOnWrite(CopyOnWrite const& source) = default;
+		CopyOnWrite(CopyOnWrite&& source) = default;
+		CopyOnWrite& operator=(CopyOnWrite const& source) = default;
+		CopyOnWrite& operator=(CopyOnWrite&& source) = default;
+
+		CopyOnWrite& operator=(T const& value) { _value = std::make_shared<T>(value); return *this; }
+		CopyOnWrite& operator=(T&& value) { _value = std::make_shared<T>(std::move(value)); return *this; }
+
+		T const& operator*() const { return _value ? *_value : GetDefault(); }
+		T const* operator->() const { return &**this; }
+
+		T& GetMutable()
+		{
+			// use_count is a relaxed load. When it sees the last reference, the acquire fence pairs with the
+			// release of the references other copies dropped, so their last reads of the value happen before
+			// it is written in place.
+			if (!_value)
+				_value = std::make_shared<T>();
+			else if (_value.use_count() > 1)
+				_value = std::make_shared<T>(*_value);
+			else
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+			return *_value;
+		}
+
+		bool IsShared() const { return _value.use_count() > 1; }
+
+	private:
+		std::shared_ptr<T> _value;
+
+		static T const& GetDefault()
+		{
+			static T const value;
+			return value;
+		}
+};
+
+#endif
+
@@ -1,554 +1,1053 @@
-#include "PCH.h"
-#include "DeterministicFiniteAutomata.h"
-#include "NondeterministicFiniteAutomata.h"
-
-namespace
-{
-	Vector<Vector<String>> operator+(Vector<Vector<String>> const& first, Vector<Vector<String>> const& second)
-	{
-		assert(first.size() == second.size());
-		for (uint32 i = 0; i < first.size(); i++)
-			assert(first[i].size() == second[i].size());
-
-		Vector<Vector<String>> sum(first.size());
-
-		for (uint32 i = 0; i < first.size(); i++)
-		{
-			sum[i].resize(first[i].size(), "");
-
-			for (uint32 j = 0; j < first[i].size(); j++)
-			{
-				if (!first[i][j].empty() && !second[i][j].empty())
-					sum[i][j] = "(" + first[i][j] + "+" + second[i][j] + ")";
-				else if (first[i][j].empty() && !second[i][j].empty())
-					sum[i][j] = second[i][j];
-				else if (!first[i][j].empty() && second[i][j].empty())
-					sum[i][j] = first[i][j];
-			}
-		}
-
-		return sum;
-	}
-
-	Vector<Vector<String>>& operator+=(Vector<Vector<String>>& vectorOne, Vector<Vector<String>> const& vectorTwo)
-	{
-		vectorOne = vectorOne + vectorTwo;
-
-		return vectorOne;
-	}
-
-	StatesSet SetMin(StatesSet const& setOne, StatesSet const& setTwo)
-	{
-		return (setOne.size() <= setTwo.size()) ? setOne : setTwo;
-	}
-
-	bool Refines(StatesSet const& Y, StatesSet const& X, StatesSet* YONE, StatesSet* YTWO)
-	{
-		if (Y.empty() || X.empty())
-			return false;
-
-		YONE->clear();
-		YTWO->clear();
-
-		for (StatesSetConstIterator itr = Y.cbegin(); itr != Y.cend(); ++itr)
-		{
-			if (X.find(*itr) != X.cend())
-				YONE->insert(*itr);
-			else
-				YTWO->insert(*itr);
-		}
-
-		if (!YONE->empty() && !YTWO->empty())
-			return true;
-
-		return false;
-	}
-}
-
-DeterministicFiniteAutomata::DeterministicFiniteAutomata(std::ifstream& ifs)
-{
-	uint32 finalStates;
-
-	ifs >> _states >> _initialState >> finalStates;
-
-	assert(_states >= 0 && (_initialState >= 0 && _initialState < _states) 
-		&& (finalStates >= 0 && finalStates <= _states));
-
-	for (uint32 i = 0; i < finalStates; ++i)
-	{
-		uint32 finalState;
-
-		ifs >> finalState;
-		_finalStates.push_back(finalState);
-	}
-
-	while (!ifs.eof())
-	{
-		char key;
-		uint32 currentState, nextState;
-
-		ifs >> currentState >> key >> nextState;
-		
-		// Check for lambda transition
-		assert(key != '0');
-
-		_transitionFunction.emplace(TransitionPair(currentState, key), StatesVector({ nextState }));
-	}
-}
-
-void DeterministicFiniteAutomata::Reverse()
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates())
-		return;
-
-	DFA reversedDFA = GetReverse().ToDFA();
-
-	_states = reversedDFA._states;
-	_finalStates = reversedDFA._finalStates;
-	_initialState = reversedDFA._initialState;
-	_transitionFunction = reversedDFA._transitionFunction;
-}
-
-void DeterministicFiniteAutomata::Minimize(bool usingHopcroft)
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates())
-		return;
-
-	StatesVector finalStates;
-	TransitionMap transitionFunction;
-	Map<Pair<Pair<StatesSet, bool>, char>, Pair<StatesSet, bool>> TransitionFunction;
-
-	Set<char> alphabet = GetAlphabet();
-	Vector<Pair<StatesSet, bool>> powerSetStates = usingHopcroft ? BuildHopcroftMinimalStates() : BuildMooreMinimalStates();
-
-	// Build transition function and final state 
-	// for minimal dfa. StatesVector are power sets from 
-	// the states of the dfa.
-	for (uint32 i = 0; i < powerSetStates.size(); ++i)
-	{
-		for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
-		{
-			Pair<StatesSet, bool> state = MoveTo(powerSetStates, powerSetStates[i], *key);
-
-			if (!state.first.empty())
-				TransitionFunction[Pair<Pair<StatesSet, bool>, char>(powerSetStates[i], *key)] = state;
-		}
-
-		if (powerSetStates[i].second)
-			finalStates.push_back(i);
-	}
-
-	// Convert the power set states in simple states.
-	Map<Pair<Pair<StatesSet, bool>, char>, Pair<StatesSet, bool>>::const_iterator itr;
-	for (itr = TransitionFunction.begin(); itr != TransitionFunction.end(); ++itr)
-	{
-		uint8 found = 0;
-		uint32 currentState = 0, nextState = 0;	// Initialize them to remove warning.
-
-		for (uint32 i = 0; i < powerSetStates.size() && found != 2; ++i)
-		{
-			if (powerSetStates[i] == itr->first.first)
-			{
-				currentState = i;
-				++found;
-			}
-
-			if (powerSetStates[i] == itr->second)
-			{
-				nextState = i;
-				++found;
-			}
-		}
-
-		if (found == 2)
-			transitionFunction.emplace(TransitionPair(currentState, itr->first.second), Vector<uint32>({ nextState }));
-	}
-
-	// Set dfa properties to minimal dfa properties.
-	_transitionFunction = transitionFunction;
-	_finalStates = finalStates;
-	_states = static_cast<uint32>(powerSetStates.size());
-}
-
-bool DeterministicFiniteAutomata::IsAccepted(String const& word) const
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates())
-		return false;
-
-	uint32 currentState = _initialState;
-
-	for (String::const_iterator itr = word.begin(); itr != word.end(); ++itr)
-	{
-		TransitionMapConstIterator iter = _transitionFunction.find(TransitionPair(currentState, *itr));
-
-		if (iter == _transitionFunction.end())
-			return false;
-
-		currentState = iter->second.front();
-	}
-
-	return IsFinalState(currentState);
-}
-
-String DeterministicFiniteAutomata::GenerateWord(uint32 const& length) const
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates() || !length)
-		return String();
-
-	String word;
-	bool found = GenerateWord(_initialState, length, &word);
-
-	if (!found)
-		return String(); 
-	
-	return word;
-}
-
-String DeterministicFiniteAutomata::GetRegularExpression() const
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates())
-		return String();
-
-	Vector<Vector<String>> coefficientsMatrix = GetCoefficientsMatrix();
-	Vector<Vector<String>> freeTermsMatrix = GetFreeTermsMatrix();
-	
-	for (int i = _states - 1; i >= 0; --i)
-	{
-		Vector<Vector<String>> _A(_states, Vector<String>(_states, ""));
-		Vector<Vector<String>> _B(_states, Vector<String>(1, ""));
-
-		ApplyArdensLemma(i, &coefficientsMatrix, &freeTermsMatrix);
-		EliminateState(i, &coefficientsMatrix, &freeTermsMatrix);
-	}
-
-	return freeTermsMatrix[0][0];
-}
-
-Vector<Vector<bool>> DeterministicFiniteAutomata::GetEquivalenceMatrix() const
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates())
-		return Vector<Vector<bool>>();
-
-	Vector<Vector<bool>> distinct(_states, Vector<bool>(_states, false));
-	Vector<Pair<uint32, uint32>> visited;
-
-	for (uint32 i = 0; i < _finalStates.size(); ++i)
-	{
-		for (uint32 j = 0; j < _finalStates[i]; ++j)
-			if (!IsFinalState(j))
-			{
-				distinct[_finalStates[i]][j] = true;
-				distinct[j][_finalStates[i]] = true;
-				visited.push_back(std::make_pair(j, _finalStates[i]));
-			}
-	}
-
-	Set<char> alphabet = GetAlphabet();
-
-	for (uint32 i = 0; i < visited.size(); ++i)
-	{
-		for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
-		{
-			for (uint32 firstState = 0; firstState < _states; ++firstState)
-			{
-				TransitionMapConstIterator firstTransition = _transitionFunction.find(TransitionPair(firstState, *key));
-
-				if (firstTransition == _transitionFunction.end())
-					continue;
-
-				if (firstTransition->second.front() != visited[i].first)
-					continue;
-
-				for (uint32 secondState = 0; secondState < _states; ++secondState)
-				{
-					TransitionMapConstIterator secondTransition = _transitionFunction.find(TransitionPair(secondState, *key));
-
-					if (secondTransition == _transitionFunction.end())
-						continue;
-
-					if ((secondTransition->second.front() != visited[i].second) || distinct[firstState][secondState])
-						continue;
-
-					visited.push_back(std::make_pair(firstState, secondState));
-					distinct[firstState][secondState] = true;
-					distinct[secondState][firstState] = true;
-				}
-			}
-		}
-	}
-
-	return distinct;
-}
-
-Vector<Vector<String>> DeterministicFiniteAutomata::GetCoefficientsMatrix() const
-{
-	Vector<Vector<String>> coefficientsMatrix(_states, Vector<String>(_states, ""));
-
-	for (TransitionMapConstIterator itr = _transitionFunction.begin(); itr != _transitionFunction.end(); ++itr)
-		coefficientsMatrix[itr->first.first][itr->second.at(0)] = itr->first.second;
-
-	return coefficientsMatrix;
-}
-
-Vector<Vector<String>> DeterministicFiniteAutomata::GetFreeTermsMatrix() const
-{
-	Vector<Vector<String>> freeTermsMatrix(_states, Vector<String>(1, ""));
-
-	for (uint32 i = 0; i < _states; ++i)
-		if (IsFinalState(i))
-			freeTermsMatrix[i][0] = '0';
-
-	return freeTermsMatrix;
-}
-
-bool DeterministicFiniteAutomata::GenerateWord(uint32 const& currentState, uint32 length, String* word) const
-{
-	if (!length && IsFinalState(currentState))
-		return true;
-
-	for (TransitionMapConstIterator itr = _transitionFunction.begin(); itr != _transitionFunction.end(); ++itr)
-	{
-		if (itr->first.first == currentState)
-		{
-			*word += itr->first.second;
-
-			for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
-			{
-				bool found = GenerateWord(*iter, length - 1, word);
-
-				if (!found)
-					word->pop_back();
-				else
-					return true;
-			}
-		}
-	}
-
-	return false;
-}
-
-void DeterministicFiniteAutomata::ApplyArdensLemma(uint32 const& index, 
-	Vector<Vector<String>>* coefficientsMatrix, Vector<Vector<String>>* freeTermsMatrix) const
-{
-	String& regex = (*coefficientsMatrix)[index][index];
-
-	if (!regex.empty())
-	{
-		ApplyArdensLemma(regex, &(*freeTermsMatrix)[index][0]);
-
-		for (uint32 i = 0; i < _states - 1; ++i)
-			ApplyArdensLemma(regex, &(*coefficientsMatrix)[index][i]);
-
-		regex.clear();
-	}
-}
-
-void DeterministicFiniteAutomata::ApplyArdensLemma(String const& regex, String* freeTerm) const
-{
-	using namespace RegularExpression;
-
-	if (freeTerm->empty())
-		return;
-
-	if ((*freeTerm) != "0")
-	{
-		*freeTerm = ((regex.size() > 1) && !IsInParentheses(regex)) ? Star(Parenthesize(regex)) + (*freeTerm) : Star(regex) + (*freeTerm);
-		return;
-	}
-
-	*freeTerm = ((regex.size() > 1) && !IsInParentheses(regex)) ? Star(Parenthesize(regex)) : Star(regex);
-}
-
-void DeterministicFiniteAutomata::EliminateState(uint32 const& index, 
-	Vector<Vector<String>>* coefficientsMatrix, Vector<Vector<String>>* freeTermsMatrix) const
-{
-	Vector<Vector<String>> _A(_states, Vector<String>(_states, ""));
-	Vector<Vector<String>> _B(_states, Vector<String>(1, ""));
-
-	for (uint32 i = 0; i < _states; ++i)
-		if (!(*coefficientsMatrix)[i][index].empty())
-			for (uint32 j = 0; j < _states; ++j)
-				if (!(*coefficientsMatrix)[index][j].empty())
-					_A[i][j] = (*coefficientsMatrix)[i][index] + (*coefficientsMatrix)[index][j];
-
-	(*coefficientsMatrix) += _A;
-
-	if (!(*freeTermsMatrix)[index][0].empty())
-		for (uint32 i = 0; i < _states; ++i)
-			if (!(*coefficientsMatrix)[i][index].empty())
-			{
-				_B[i][0] = (*coefficientsMatrix)[i][index];
-
-				if ((*freeTermsMatrix)[index][0] != "0")
-					_B[i][0] += (*freeTermsMatrix)[index][0];
-			}
-
-	(*freeTermsMatrix) += _B;
-}
-
-Vector<Pair<StatesSet, bool>> DeterministicFiniteAutomata::BuildMooreMinimalStates() const
-{
-	Vector<bool> marked(_states, false);
-	Vector<Pair<StatesSet, bool>> states;
-	Vector<Vector<bool>> distinct = GetEquivalenceMatrix();
-
-	for (uint32 i = 0; i < distinct.size(); ++i)
-	{
-		if (marked[i])
-			continue;
-
-		marked[i] = true;
-
-		bool final = false;
-
-		StatesSet powerSet = { i };
-
-		if (IsFinalState(i))
-			final = true;
-
-		for (uint32 j = i + 1; j < distinct.size(); ++j)
-			if (!distinct[j][i])
-			{
-				powerSet.insert(j);
-				marked[j] = true;
-
-				if (!final && IsFinalState(j))
-					final = true;
-			}
-
-		states.push_back(std::make_pair(powerSet, final));
-	}
-
-	return states;
-}
-
-Vector<Pair<StatesSet, bool>> DeterministicFiniteAutomata::BuildHopcroftMinimalStates() const
-{
-	Set<char> alphabet = GetAlphabet();
-	Vector<StatesSet> P = { GetInconclusiveStates(), GetFinalStates() };
-	Vector<StatesSet> W;
-	W.push_back(SetMin(P.front(), P.back()));
-
-	while (!W.empty())
-	{
-		StatesSet A = W.front();
-		W.erase(W.begin());
-
-		for (Set<char>::const_iterator itr = alphabet.cbegin(); itr != alphabet.cend(); ++itr)
-		{
-			StatesSet predeccesors = GetPredeccesors(A, *itr);
-
-			if (predeccesors.empty())
-				continue;
-
-			Vector<StatesSet>::const_iterator iter = P.cbegin();
-
-			while (iter != P.cend())
-			{
-				StatesSet YONE, YTWO;
-
-				if (!Refines(*iter, predeccesors, &YONE, &YTWO))
-				{
-					++iter;
-					continue;
-				}
-
-				Vector<StatesSet>::const_iterator iterator = std::find(W.cbegin(), W.cend(), *iter);
-
-				if (iterator != W.cend())
-				{
-					W.erase(iterator);
-					W.push_back(YONE);
-					W.push_back(YTWO);
-				}
-				else
-					W.push_back(SetMin(YONE, YTWO));
-
-				iter = P.insert(iter, YTWO);
-				iter = P.insert(iter, YONE);
-				iter = P.erase(iter + 2);
-			}
-		}
-	}
-
-	Vector<Pair<StatesSet, bool>> powerSetStates;
-
-	for (Vector<StatesSet>::const_iterator itr = P.cbegin(); itr != P.cend(); ++itr)
-	{
-		bool final = false;
-
-		for (StatesSet::const_iterator iter = itr->cbegin(); iter != itr->cend() && !final; ++iter)
-			if (IsFinalState((*iter)))
-				final = true;
-
-		powerSetStates.emplace_back(*itr, final);
-	}
-
-	return powerSetStates;
-}
-
-StatesSet DeterministicFiniteAutomata::GetPredeccesors(StatesSet const& statesSet, char const& key) const
-{
-	if (!HasStates() || !HasTransitions())
-		return StatesSet();
-
-	StatesSet predeccesors;
-
-	for (TransitionMapConstIterator itr = _transitionFunction.cbegin(); itr != _transitionFunction.cend(); ++itr)
-	{
-		if (itr->first.second != key)
-			continue;
-
-		for (uint32 i = 0; i < itr->second.size(); ++i)
-		{
-			if (statesSet.find(itr->second[i]) != statesSet.end())
-				predeccesors.insert(itr->first.first);
-		}
-	}
-
-	return predeccesors;
-}
-
-Pair<StatesSet, bool> DeterministicFiniteAutomata::MoveTo(Vector<Pair<StatesSet, bool>> const& powerSetStates, 
-	Pair<StatesSet, bool> const& states, char const& key) const
-{
-	if (states.first.empty())
-		return Pair<StatesSet, bool>();
-
-	bool final = false;
-	StatesSet closure;
-
-	for (StatesSetConstIterator itr = states.first.begin(); itr != states.first.end(); ++itr)
-	{
-		TransitionMapConstIterator iter = _transitionFunction.find(TransitionPair(*itr, key));
-
-		if (iter != _transitionFunction.end())
-		{
-			closure.insert(iter->second.front());
-
-			if (!final && IsFinalState(iter->second.front()))
-				final = true;
-		}
-	}
-
-	if (closure.empty())
-		return Pair<StatesSet, bool>();
-
-	// Look for it in powerSetStates
-	// closure is not guaranteed in powerSetStates
-	// it may be just a power set of a state from powerSetStates.
-	
-	// It is in powerSetStates.
-	Vector<Pair<StatesSet, bool>>::const_iterator itr;
-	for (itr = powerSetStates.begin(); itr != powerSetStates.end(); ++itr)
-		if (itr->first == closure)
-			return Pair<StatesSet, bool>(closure, final);
-
-	// closure is just a power set of state from powerSetStates.
-	for (uint32 i = 0; i < powerSetStates.size(); ++i)
-		if (std::find(powerSetStates[i].first.begin(), powerSetStates[i].first.end(), *(closure.begin())) != powerSetStates[i].first.end())
-			return powerSetStates[i];
-
-	return Pair<StatesSet, bool>();
-}
-
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+#include "NondeterministicFiniteAutomata.h"
+#include "Statistics.h"
+#include "ShuffleMatcher.h"
+#include "TransitionTable.h"
+
+namespace
+{
+	// Chunks shorter than this are not worth a thread in IsAcceptedParallel.
+	uint64 const ParallelMinimumChunkLength = 1 << 16;
+
+	// A dense states x 256 table is used for chunk matching while it stays below this many entries.
+	uint64 const DenseTableMaximumSize = 1 << 22;
+
+	// First bytes of a file of WriteBinary, "LFAD" in little endian.
+	uint32 const BinaryMagic = 0x4441464C;
+
+	template <typename T>
+	void WriteValue(std::ofstream& ofs, T const& value)
+	{
+		ofs.write(reinterpret_cast<char const*>(&value), sizeof(value));
+	}
+
+	template <typename T>
+	bool ReadValue(std::ifstream& ifs, T* value)
+	{
+		return static_cast<bool>(ifs.read(reinterpret_cast<char*>(value), sizeof(*value)));
+	}
+
+	// Next state lookups for chunk matching.
+	class StepFunction
+	{
+		public:
+			explicit StepFunction(TransitionTable const& table) : _table(table)
+			{
+				if (static_cast<uint64>(table.GetStates()) * 256 > DenseTableMaximumSize)
+					return;
+
+				_dense.assign(static_cast<uint64>(table.GetStates()) * 256, TransitionTable::InvalidState);
+
+				for (uint32 state = 0; state < table.GetStates(); ++state)
+					for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+						_dense[state * 256 + static_cast<uint8>(table.GetSymbol(edge))] = *table.GetTargets(edge).first;
+			}
+
+			uint32 GetNextState(uint32 const& state, char const& key) const
+			{
+				if (_dense.empty())
+					return _table.GetNextState(state, key);
+
+				return _dense[state * 256 + static_cast<uint8>(key)];
+			}
+
+		private:
+			TransitionTable const& _table;
+			StatesVector _dense;
+	};
+
+	// Runs [begin, end) from every state of starts at once and returns the state each start ends in,
+	// TransitionTable::InvalidState if it dies. Starts that reach the same state are merged into
+	// one lane, checking for that after 1, 2, 4, ... bytes.
+	StatesVector RunChunk(StepFunction const& step, uint32 const& states, StatesVector const& starts, 
+		char const* begin, char const* end)
+	{
+		StatesVector lanes(starts), laneOf(starts.size()), slot(states), slotStamp(states, 0);
+		uint32 stamp = 0;
+		uint64 position = 0, nextMerge = 1;
+
+		for (uint32 i = 0; i < laneOf.size(); ++i)
+			laneOf[i] = i;
+
+		for (; begin != end && !lanes.empty(); ++begin)
+		{
+			bool died = false;
+
+			for (uint32 i = 0; i < lanes.size(); ++i)
+			{
+				lanes[i] = step.GetNextState(lanes[i], *begin);
+
+				if (lanes[i] == TransitionTable::InvalidState)
+					died = true;
+			}
+
+			if (++position != nextMerge && !died)
+				continue;
+
+			// Merge lanes in the same state and drop the dead ones.
+			StatesVector merged, remap(lanes.size(), TransitionTable::InvalidState);
+			++stamp;
+
+			for (uint32 i = 0; i < lanes.size(); ++i)
+			{
+				if (lanes[i] == TransitionTable::InvalidState)
+					continue;
+
+				if (slotStamp[lanes[i]] != stamp)
+				{
+					slotStamp[lanes[i]] = stamp;
+					slot[lanes[i]] = static_cast<uint32>(merged.size());
+					merged.push_back(lanes[i]);
+				}
+
+				remap[i] = slot[lanes[i]];
+			}
+
+			for (uint32 i = 0; i < laneOf.size(); ++i)
+				if (laneOf[i] != TransitionTable::InvalidState)
+					laneOf[i] = remap[laneOf[i]];
+
+			lanes.swap(merged);
+
+			if (position == nextMerge)
+				nextMerge *= 2;
+		}
+
+		StatesVector result(starts.size(), TransitionTable::InvalidState);
+
+		for (uint32 i = 0; i < laneOf.size(); ++i)
+			if (laneOf[i] != TransitionTable::InvalidState)
+				result[i] = lanes[laneOf[i]];
+
+		return result;
+	}
+
+	Vector<Vector<String>> operator+(Vector<Vector<String>> const& first, Vector<Vector<String>> const& second)
+	{
+		assert(first.size() == second.size());
+		for (uint32 i = 0; i < first.size(); i++)
+			assert(first[i].size() == second[i].size());
+
+		Vector<Vector<String>> sum(first.size());
+
+		for (uint32 i = 0; i < first.size(); i++)
+		{
+			sum[i].resize(first[i].size(), "");
+
+			for (uint32 j = 0; j < first[i].size(); j++)
+			{
+				if (!first[i][j].empty() && !second[i][j].empty())
+					sum[i][j] = "(" + first[i][j] + "+" + second[i][j] + ")";
+				else if (first[i][j].empty() && !second[i][j].empty())
+					sum[i][j] = second[i][j];
+				else if (!first[i][j].empty() && second[i][j].empty())
+					sum[i][j] = first[i][j];
+			}
+		}
+
+		return sum;
+	}
+
+	Vector<Vector<String>>& operator+=(Vector<Vector<String>>& vectorOne, Vector<Vector<String>> const& vectorTwo)
+	{
+		vectorOne = vectorOne + vectorTwo;
+
+		return vectorOne;
+	}
+
+	StatesSet SetMin(StatesSet const& setOne, StatesSet const& setTwo)
+	{
+		return (setOne.size() <= setTwo.size()) ? setOne : setTwo;
+	}
+
+	bool Refines(StatesSet const& Y, StatesSet const& X, StatesSet* YONE, StatesSet* YTWO)
+	{
+		if (Y.empty() || X.empty())
+			return false;
+
+		YONE->clear();
+		YTWO->clear();
+
+		for (StatesSetConstIterator itr = Y.cbegin(); itr != Y.cend(); ++itr)
+		{
+			if (X.find(*itr) != X.cend())
+				YONE->insert(*itr);
+			else
+				YTWO->insert(*itr);
+		}
+
+		if (!YONE->empty() && !YTWO->empty())
+			return true;
+
+		return false;
+	}
+}
+
+DeterministicFiniteAutomata::DeterministicFiniteAutomata(std::ifstream& ifs)
+{
+	uint32 finalStates;
+
+	ifs >> _states >> _initialState >> finalStates;
+
+	assert(_states >= 0 && (_initialState >= 0 && _initialState < _states) 
+		&& (finalStates >= 0 && finalStates <= _states));
+
+	for (uint32 i = 0; i < finalStates; ++i)
+	{
+		uint32 finalState;
+
+		ifs >> finalState;
+		_finalStates.GetMutable().push_back(finalState);
+	}
+
+	char key;
+	uint32 currentState, nextState;
+	TransitionsVector transitions;
+
+	// DFAs have no lambda transitions, so '0' is read as an ordinary symbol.
+	while (ifs >> currentState >> key >> nextState)
+		transitions.emplace_back(TransitionPair(currentState, key), nextState);
+
+	// A repeated transition keeps its first target.
+	std::stable_sort(transitions.begin(), transitions.end(), 
+		[](Pair<TransitionPair, uint32> const& first, Pair<TransitionPair, uint32> const& second) { return first.first < second.first; });
+	transitions.erase(std::unique(transitions.begin(), transitions.end(), 
+		[](Pair<TransitionPair, uint32> const& first, Pair<TransitionPair, uint32> const& second) { return first.first == second.first; }), 
+		transitions.end());
+
+	_transitionTable = TransitionTable(_states, std::move(transitions));
+}
+
+void DeterministicFiniteAutomata::Reverse()
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates())
+		return;
+
+	*this = GetReverseDFA();
+}
+
+void DeterministicFiniteAutomata::Minimize(bool usingHopcroft)
+{
+	if (!HasStates())
+		return;
+
+	LFA_STATISTICS_OPERATION("Minimize");
+
+	// Both algorithms read a missing transition as one to a dead state, which holds once the useless states are gone.
+	// Without transitions or final states it is all that is left to do.
+	Trim();
+
+	if (!HasTransitions() || !HasFinalStates())
+		return;
+
+	StatesVector finalStates;
+	TransitionsVector transitions;
+	Map<Pair<Pair<StatesSet, bool>, char>, Pair<StatesSet, bool>> TransitionFunction;
+
+	Set<char> alphabet = GetAlphabet();
+	Vector<Pair<StatesSet, bool>> powerSetStates;
+
+	{
+		LFA_STATISTICS_PHASE(usingHopcroft ? "Hopcroft" : "Moore");
+		powerSetStates = usingHopcroft ? BuildHopcroftMinimalStates() : BuildMooreMinimalStates();
+	}
+
+	LFA_STATISTICS_PHASE("Building");
+
+	// Build transition function and final state 
+	// for minimal dfa. StatesVector are power sets from 
+	// the states of the dfa.
+	for (uint32 i = 0; i < powerSetStates.size(); ++i)
+	{
+		for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
+		{
+			Pair<StatesSet, bool> state = MoveTo(powerSetStates, powerSetStates[i], *key);
+
+			if (!state.first.empty())
+				TransitionFunction[Pair<Pair<StatesSet, bool>, char>(powerSetStates[i], *key)] = state;
+		}
+
+		if (powerSetStates[i].second)
+			finalStates.push_back(i);
+	}
+
+	// Convert the power set states in simple states.
+	Map<Pair<Pair<StatesSet, bool>, char>, Pair<StatesSet, bool>>::const_iterator itr;
+	for (itr = TransitionFunction.begin(); itr != TransitionFunction.end(); ++itr)
+	{
+		uint8 found = 0;
+		uint32 currentState = 0, nextState = 0;	// Initialize them to remove warning.
+
+		for (uint32 i = 0; i < powerSetStates.size() && found != 2; ++i)
+		{
+			if (powerSetStates[i] == itr->first.first)
+			{
+				currentState = i;
+				++found;
+			}
+
+			if (powerSetStates[i] == itr->second)
+			{
+				nextState = i;
+				++found;
+			}
+		}
+
+		if (found == 2)
+			transitions.emplace_back(TransitionPair(currentState, itr->first.second), nextState);
+	}
+
+	// Set dfa properties to minimal dfa properties.
+	for (uint32 i = 0; i < powerSetStates.size(); ++i)
+		if (powerSetStates[i].first.count(_initialState))
+		{
+			_initialState = i;
+			break;
+		}
+
+	_states = static_cast<uint32>(powerSetStates.size());
+	_transitionTable = TransitionTable(_states, std::move(transitions));
+	_finalStates = std::move(finalStates);
+
+	OnChanged();
+}
+
+bool DeterministicFiniteAutomata::IsAccepted(String const& word) const
+{
+	// Without transitions only the empty word can be accepted, the loop below handles it.
+	if (!HasStates() || !HasFinalStates())
+		return false;
+
+	LFA_STATISTICS_OPERATION("IsAccepted");
+
+	// The matcher is built once and kept with the automaton, so even words of a few bytes are matched faster by it.
+	std::shared_ptr<ShuffleMatcher const> const matcher = GetShuffleMatcher();
+
+	if (matcher)
+		return matcher->IsAccepted(word);
+
+	TransitionTable const& table = *_transitionTable;
+	uint32 currentState = _initialState;
+
+	for (String::const_iterator itr = word.begin(); itr != word.end(); ++itr)
+	{
+		LFA_STATISTICS_ADD(transitionLookups, 1);
+
+		currentState = table.GetNextState(currentState, *itr);
+
+		if (currentState == TransitionTable::InvalidState)
+			return false;
+	}
+
+	return IsFinalState(currentState);
+}
+
+bool DeterministicFiniteAutomata::IsAccepted(String const& word, VisitProfile* profile) const
+{
+	if (!HasStates())
+		return false;
+
+	if (profile->size() < _states)
+		profile->resize(_states, 0);
+
+	TransitionTable const& table = *_transitionTable;
+	uint32 currentState = _initialState;
+	++(*profile)[currentState];
+
+	for (String::const_iterator itr = word.begin(); itr != word.end(); ++itr)
+	{
+		currentState = table.GetNextState(currentState, *itr);
+
+		if (currentState == TransitionTable::InvalidState)
+			return false;
+
+		++(*profile)[currentState];
+	}
+
+	return IsFinalState(currentState);
+}
+
+bool DeterministicFiniteAutomata::IsAcceptedParallel(String const& word, uint32 threads) const
+{
+	if (!HasStates() || !HasFinalStates())
+		return false;
+
+	if (!threads)
+		threads = std::max(std::thread::hardware_concurrency(), 1U);
+
+	uint32 const chunks = static_cast<uint32>(std::min<uint64>(threads, word.size() / ParallelMinimumChunkLength));
+
+	if (chunks <= 1 || !HasTransitions())
+		return IsAccepted(word);
+
+	LFA_STATISTICS_OPERATION("IsAcceptedParallel");
+
+	char const* const data = word.data();
+	Vector<uint64> bounds(chunks + 1);
+	Vector<std::thread> workers;
+
+	for (uint32 i = 0; i <= chunks; ++i)
+		bounds[i] = word.size() * i / chunks;
+
+	std::shared_ptr<ShuffleMatcher const> const shuffleMatcher = GetShuffleMatcher();
+
+	if (shuffleMatcher)
+	{
+		// Every chunk runs from all the 16 lanes.
+		ShuffleMatcher const& matcher = *shuffleMatcher;
+		Vector<Vector<uint8>> lanes(chunks, Vector<uint8>(ShuffleMatcher::Lanes));
+
+		for (uint32 i = 0; i < chunks; ++i)
+			for (uint32 j = 0; j < ShuffleMatcher::Lanes; ++j)
+				lanes[i][j] = static_cast<uint8>(j);
+
+		for (uint32 i = 1; i < chunks; ++i)
+			workers.emplace_back([&, i]() { matcher.Run(data + bounds[i], data + bounds[i + 1], lanes[i].data()); });
+
+		matcher.Run(data, data + bounds[1], lanes[0].data());
+
+		for (uint32 i = 0; i < workers.size(); ++i)
+			workers[i].join();
+
+		uint8 state = matcher.GetInitialState();
+
+		for (uint32 i = 0; i < chunks; ++i)
+			state = lanes[i][state];
+
+		return matcher.IsFinalState(state);
+	}
+
+	TransitionTable const& table = GetTransitionTable();
+	StepFunction const step(table);
+	Vector<StatesVector> targets(256);	// Targets of the transitions on every symbol.
+	Vector<StatesVector> starts(chunks), ends(chunks);
+
+	for (uint32 edge = 0; edge < table.GetEdgesCount(); ++edge)
+		targets[static_cast<uint8>(table.GetSymbol(edge))].push_back(*table.GetTargets(edge).first);
+
+	// A chunk can only start in a state entered by the last symbol of the previous chunk.
+	starts[0].push_back(_initialState);
+
+	for (uint32 i = 1; i < chunks; ++i)
+	{
+		starts[i] = targets[static_cast<uint8>(word[bounds[i] - 1])];
+		std::sort(starts[i].begin(), starts[i].end());
+		starts[i].erase(std::unique(starts[i].begin(), starts[i].end()), starts[i].end());
+	}
+
+	for (uint32 i = 1; i < chunks; ++i)
+		workers.emplace_back([&, i]() { ends[i] = RunChunk(step, table.GetStates(), starts[i], data + bounds[i], data + bounds[i + 1]); });
+
+	ends[0] = RunChunk(step, table.GetStates(), starts[0], data, data + bounds[1]);
+
+	for (uint32 i = 0; i < workers.size(); ++i)
+		workers[i].join();
+
+	// Compose the chunk mappings left to right.
+	uint32 state = ends[0].front();
+
+	for (uint32 i = 1; i < chunks && state != TransitionTable::InvalidState; ++i)
+	{
+		StatesConstIterator itr = std::lower_bound(starts[i].begin(), starts[i].end(), state);
+		assert(itr != starts[i].end() && (*itr) == state);
+
+		state = ends[i][itr - starts[i].begin()];
+	}
+
+	return state != TransitionTable::InvalidState && IsFinalState(state);
+}
+
+Vector<bool> DeterministicFiniteAutomata::IsAccepted(Vector<String> const& words) const
+{
+	if (!HasStates() || !HasFinalStates())
+		return Vector<bool>(words.size(), false);
+
+	std::shared_ptr<ShuffleMatcher const> const matcher = GetShuffleMatcher();
+
+	if (matcher)
+		return matcher->IsAccepted(words);
+
+	Vector<bool> accepted(words.size(), false);
+
+	for (uint32 i = 0; i < words.size(); ++i)
+		accepted[i] = IsAccepted(words[i]);
+
+	return accepted;
+}
+
+Vector<bool> DeterministicFiniteAutomata::AreAcceptedSorted(Vector<String> const& words) const
+{
+	if (!HasStates() || !HasFinalStates())
+		return Vector<bool>(words.size(), false);
+
+	TransitionTable const& table = GetTransitionTable();
+	Vector<bool> finalStates(_states, false), accepted(words.size(), false);
+	StatesVector path({ _initialState });	// path[i] is the state reached by the first i symbols of the previous word.
+	size_t deadLength = String::npos;	// Length of the shortest prefix of the previous word without a path.
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		finalStates[*itr] = true;
+
+	for (uint32 i = 0; i < words.size(); ++i)
+	{
+		String const& word = words[i];
+		size_t common = 0;
+
+		if (i)
+		{
+			String const& previous = words[i - 1];
+			size_t const limit = std::min(std::min(word.size(), previous.size()), std::max(path.size() - 1, deadLength));
+
+			while (common < limit && word[common] == previous[common])
+				++common;
+		}
+
+		if (common >= deadLength)
+			continue;
+
+		path.resize(std::min(path.size(), common + 1));
+		deadLength = String::npos;
+
+		for (size_t length = path.size() - 1; length < word.size(); ++length)
+		{
+			LFA_STATISTICS_ADD(transitionLookups, 1);
+
+			TargetsRange targets = table.Find(path.back(), word[length]);
+
+			if (targets.first == targets.second)
+			{
+				deadLength = length + 1;
+				break;
+			}
+
+			path.push_back(*targets.first);
+		}
+
+		accepted[i] = deadLength == String::npos && finalStates[path.back()];
+	}
+
+	return accepted;
+}
+
+String DeterministicFiniteAutomata::GenerateWord(uint32 const& length) const
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates() || !length)
+		return String();
+
+	String word;
+	bool found = GenerateWord(_initialState, length, &word);
+
+	if (!found)
+		return String(); 
+	
+	return word;
+}
+
+String DeterministicFiniteAutomata::GetRegularExpression() const
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates())
+		return String();
+
+	Vector<Vector<String>> coefficientsMatrix = GetCoefficientsMatrix();
+	Vector<Vector<RegularExpression::Term>> freeTermsMatrix = GetFreeTermsMatrix();
+	
+	for (int i = _states - 1; i >= 0; --i)
+	{
+		Vector<Vector<String>> _A(_states, Vector<String>(_states, ""));
+		Vector<Vector<String>> _B(_states, Vector<String>(1, ""));
+
+		ApplyArdensLemma(i, &coefficientsMatrix, &freeTermsMatrix);
+		EliminateState(i, &coefficientsMatrix, &freeTermsMatrix);
+	}
+
+	return RegularExpression::ToString(freeTermsMatrix[0][0]);
+}
+
+Vector<Vector<bool>> DeterministicFiniteAutomata::GetEquivalenceMatrix() const
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates())
+		return Vector<Vector<bool>>();
+
+	TransitionTable const& table = *_transitionTable;
+	Vector<Vector<bool>> distinct(_states, Vector<bool>(_states, false));
+	Vector<Pair<uint32, uint32>> visited;
+	Vector<bool> finalStates(_states, false);
+	Set<char> alphabet = GetAlphabet();
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		finalStates[*itr] = true;
+
+	// A missing transition leads to an implicit dead state, so a state with a transition on a symbol
+	// and a state without one are distinct as well. This is exact when every state can reach a final one, see Trim.
+	for (uint32 i = 0; i < _states; ++i)
+		for (uint32 j = i + 1; j < _states; ++j)
+		{
+			bool different = finalStates[i] != finalStates[j];
+
+			for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end() && !different; ++key)
+				different = (table.FindEdge(i, *key) == TransitionTable::InvalidState) !=
+					(table.FindEdge(j, *key) == TransitionTable::InvalidState);
+
+			if (different)
+			{
+				distinct[i][j] = true;
+				distinct[j][i] = true;
+				visited.push_back(std::make_pair(i, j));
+			}
+		}
+
+	for (uint32 i = 0; i < visited.size(); ++i)
+	{
+		LFA_STATISTICS_ADD(refinementRounds, 1);
+
+		for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
+		{
+			for (uint32 firstState = 0; firstState < _states; ++firstState)
+			{
+				if (table.GetNextState(firstState, *key) != visited[i].first)
+					continue;
+
+				for (uint32 secondState = 0; secondState < _states; ++secondState)
+				{
+					if ((table.GetNextState(secondState, *key) != visited[i].second) || distinct[firstState][secondState])
+						continue;
+
+					LFA_STATISTICS_ADD(refinementSplits, 1);
+
+					visited.push_back(std::make_pair(firstState, secondState));
+					distinct[firstState][secondState] = true;
+					distinct[secondState][firstState] = true;
+				}
+			}
+		}
+	}
+
+	return distinct;
+}
+
+Vector<Vector<String>> DeterministicFiniteAutomata::GetCoefficientsMatrix() const
+{
+	Vector<Vector<String>> coefficientsMatrix(_states, Vector<String>(_states, ""));
+
+	TransitionTable const& table = *_transitionTable;
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			coefficientsMatrix[state][*table.GetTargets(edge).first] = table.GetSymbol(edge);
+
+	return coefficientsMatrix;
+}
+
+Vector<Vector<RegularExpression::Term>> DeterministicFiniteAutomata::GetFreeTermsMatrix() const
+{
+	Vector<Vector<RegularExpression::Term>> freeTermsMatrix(_states, Vector<RegularExpression::Term>(1));
+
+	for (uint32 i = 0; i < _states; ++i)
+		if (IsFinalState(i))
+			freeTermsMatrix[i][0].emptyWord = true;
+
+	return freeTermsMatrix;
+}
+
+bool DeterministicFiniteAutomata::GenerateWord(uint32 const& currentState, uint32 length, String* word) const
+{
+	if (!length && IsFinalState(currentState))
+		return true;
+
+	TransitionTable const& table = *_transitionTable;
+
+	for (uint32 edge = table.GetEdgesBegin(currentState); edge < table.GetEdgesEnd(currentState); ++edge)
+	{
+		*word += table.GetSymbol(edge);
+
+		if (GenerateWord(*table.GetTargets(edge).first, length - 1, word))
+			return true;
+
+		word->pop_back();
+	}
+
+	return false;
+}
+
+void DeterministicFiniteAutomata::ApplyArdensLemma(uint32 const& index, 
+	Vector<Vector<String>>* coefficientsMatrix, Vector<Vector<RegularExpression::Term>>* freeTermsMatrix) const
+{
+	String& regex = (*coefficientsMatrix)[index][index];
+
+	if (!regex.empty())
+	{
+		ApplyArdensLemma(regex, &(*freeTermsMatrix)[index][0]);
+
+		for (uint32 i = 0; i < _states - 1; ++i)
+			ApplyArdensLemma(regex, &(*coefficientsMatrix)[index][i]);
+
+		regex.clear();
+	}
+}
+
+void DeterministicFiniteAutomata::ApplyArdensLemma(String const& regex, String* coefficient) const
+{
+	using namespace RegularExpression;
+
+	if (coefficient->empty())
+		return;
+
+	*coefficient = ((regex.size() > 1) && !IsInParentheses(regex)) ? Star(Parenthesize(regex)) + (*coefficient) : Star(regex) + (*coefficient);
+}
+
+void DeterministicFiniteAutomata::ApplyArdensLemma(String const& regex, RegularExpression::Term* freeTerm) const
+{
+	using namespace RegularExpression;
+
+	if (freeTerm->IsEmpty())
+		return;
+
+	// regex* already matches the empty word, so it takes the place of the flag.
+	String const star = ((regex.size() > 1) && !IsInParentheses(regex)) ? Star(Parenthesize(regex)) : Star(regex);
+	String expression = freeTerm->expression;
+
+	if (!expression.empty())
+		ApplyArdensLemma(regex, &expression);
+
+	*freeTerm = Term(freeTerm->emptyWord ? Union(expression, star) : expression, false);
+}
+
+void DeterministicFiniteAutomata::EliminateState(uint32 const& index, 
+	Vector<Vector<String>>* coefficientsMatrix, Vector<Vector<RegularExpression::Term>>* freeTermsMatrix) const
+{
+	using namespace RegularExpression;
+
+	Vector<Vector<String>> _A(_states, Vector<String>(_states, ""));
+	Vector<Term> _B(_states);
+
+	for (uint32 i = 0; i < _states; ++i)
+		if (!(*coefficientsMatrix)[i][index].empty())
+			for (uint32 j = 0; j < _states; ++j)
+				if (!(*coefficientsMatrix)[index][j].empty())
+					_A[i][j] = (*coefficientsMatrix)[i][index] + (*coefficientsMatrix)[index][j];
+
+	(*coefficientsMatrix) += _A;
+
+	Term const& freeTerm = (*freeTermsMatrix)[index][0];
+
+	if (!freeTerm.IsEmpty())
+		for (uint32 i = 0; i < _states; ++i)
+		{
+			String const& coefficient = (*coefficientsMatrix)[i][index];
+
+			if (coefficient.empty())
+				continue;
+
+			String expression = freeTerm.expression.empty() ? String() : coefficient + freeTerm.expression;
+
+			_B[i] = Term(freeTerm.emptyWord ? Union(expression, coefficient) : expression, false);
+		}
+
+	for (uint32 i = 0; i < _states; ++i)
+		(*freeTermsMatrix)[i][0] = Union((*freeTermsMatrix)[i][0], _B[i]);
+}
+
+Vector<Pair<StatesSet, bool>> DeterministicFiniteAutomata::BuildMooreMinimalStates() const
+{
+	Vector<bool> marked(_states, false);
+	Vector<Pair<StatesSet, bool>> states;
+	Vector<Vector<bool>> distinct = GetEquivalenceMatrix();
+
+	for (uint32 i = 0; i < distinct.size(); ++i)
+	{
+		if (marked[i])
+			continue;
+
+		marked[i] = true;
+
+		bool final = false;
+
+		StatesSet powerSet = { i };
+
+		if (IsFinalState(i))
+			final = true;
+
+		for (uint32 j = i + 1; j < distinct.size(); ++j)
+			if (!distinct[j][i])
+			{
+				powerSet.insert(j);
+				marked[j] = true;
+
+				if (!final && IsFinalState(j))
+					final = true;
+			}
+
+		states.push_back(std::make_pair(powerSet, final));
+	}
+
+	return states;
+}
+
+Vector<Pair<StatesSet, bool>> DeterministicFiniteAutomata::BuildHopcroftMinimalStates() const
+{
+	Set<char> alphabet = GetAlphabet();
+	Vector<StatesSet> P = { GetInconclusiveStates(), GetFinalStates() };
+
+	if (P.front().empty())
+		P.erase(P.begin());
+
+	// Missing transitions lead to an implicit dead state outside of P, so both blocks are splitters.
+	// Starting with the smaller one only suffices for complete DFAs.
+	Vector<StatesSet> W = P;
+
+	while (!W.empty())
+	{
+		StatesSet A = W.front();
+		W.erase(W.begin());
+
+		LFA_STATISTICS_ADD(refinementRounds, 1);
+
+		for (Set<char>::const_iterator itr = alphabet.cbegin(); itr != alphabet.cend(); ++itr)
+		{
+			StatesSet predeccesors = GetPredeccesors(A, *itr);
+
+			if (predeccesors.empty())
+				continue;
+
+			Vector<StatesSet>::const_iterator iter = P.cbegin();
+
+			while (iter != P.cend())
+			{
+				StatesSet YONE, YTWO;
+
+				if (!Refines(*iter, predeccesors, &YONE, &YTWO))
+				{
+					++iter;
+					continue;
+				}
+
+				LFA_STATISTICS_ADD(refinementSplits, 1);
+
+				Vector<StatesSet>::const_iterator iterator = std::find(W.cbegin(), W.cend(), *iter);
+
+				if (iterator != W.cend())
+				{
+					W.erase(iterator);
+					W.push_back(YONE);
+					W.push_back(YTWO);
+				}
+				else
+					W.push_back(SetMin(YONE, YTWO));
+
+				iter = P.insert(iter, YTWO);
+				iter = P.insert(iter, YONE);
+				iter = P.erase(iter + 2);
+			}
+		}
+	}
+
+	Vector<Pair<StatesSet, bool>> powerSetStates;
+
+	for (Vector<StatesSet>::const_iterator itr = P.cbegin(); itr != P.cend(); ++itr)
+	{
+		bool final = false;
+
+		for (StatesSet::const_iterator iter = itr->cbegin(); iter != itr->cend() && !final; ++iter)
+			if (IsFinalState((*iter)))
+				final = true;
+
+		powerSetStates.emplace_back(*itr, final);
+	}
+
+	return powerSetStates;
+}
+
+StatesSet DeterministicFiniteAutomata::GetPredeccesors(StatesSet const& statesSet, char const& key) const
+{
+	if (!HasStates() || !HasTransitions())
+		return StatesSet();
+
+	StatesSet predeccesors;
+
+	TransitionTable const& table = *_transitionTable;
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+	{
+		uint32 next = table.GetNextState(state, key);
+
+		if (next != TransitionTable::InvalidState && statesSet.find(next) != statesSet.end())
+			predeccesors.insert(state);
+	}
+
+	return predeccesors;
+}
+
+Pair<StatesSet, bool> DeterministicFiniteAutomata::MoveTo(Vector<Pair<StatesSet, bool>> const& powerSetStates, 
+	Pair<StatesSet, bool> const& states, char const& key) const
+{
+	if (states.first.empty())
+		return Pair<StatesSet, bool>();
+
+	bool final = false;
+	StatesSet closure;
+
+	for (StatesSetConstIterator itr = states.first.begin(); itr != states.first.end(); ++itr)
+	{
+		uint32 next = _transitionTable->GetNextState(*itr, key);
+
+		if (next != TransitionTable::InvalidState)
+		{
+			closure.insert(next);
+
+			if (!final && IsFinalState(next))
+				final = true;
+		}
+	}
+
+	if (closure.empty())
+		return Pair<StatesSet, bool>();
+
+	// Look for it in powerSetStates
+	// closure is not guaranteed in powerSetStates
+	// it may be just a power set of a state from powerSetStates.
+	
+	// It is in powerSetStates.
+	Vector<Pair<StatesSet, bool>>::const_iterator itr;
+	for (itr = powerSetStates.begin(); itr != powerSetStates.end(); ++itr)
+		if (itr->first == closure)
+			return Pair<StatesSet, bool>(closure, final);
+
+	// closure is just a power set of state from powerSetStates.
+	for (uint32 i = 0; i < powerSetStates.size(); ++i)
+		if (std::find(powerSetStates[i].first.begin(), powerSetStates[i].first.end(), *(closure.begin())) != powerSetStates[i].first.end())
+			return powerSetStates[i];
+
+	return Pair<StatesSet, bool>();
+}
+
+void DeterministicFiniteAutomata::WriteBinary(std::ofstream& ofs) const
+{
+	TransitionTable const& table = *_transitionTable;
+	uint32 indexes = std::max(_states, table.GetStates());
+
+	if (HasStates())
+		indexes = std::max(indexes, _initialState + 1);
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		indexes = std::max(indexes, (*itr) + 1);
+
+	WriteBinaryHeader(ofs, _states, indexes, _initialState, static_cast<uint32>(_finalStates->size()), table.GetEdgesCount());
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		WriteValue(ofs, *itr);
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			WriteBinaryTransition(ofs, state, table.GetSymbol(edge), *table.GetTargets(edge).first);
+}
+
+bool DeterministicFiniteAutomata::ReadBinary(std::ifstream& ifs, DeterministicFiniteAutomata* dfa)
+{
+	uint32 magic, states, indexes, initialState, finalStatesCount;
+	uint64 transitionsCount;
+
+	if (!ReadValue(ifs, &magic) || magic != BinaryMagic || !ReadValue(ifs, &states) || !ReadValue(ifs, &indexes) ||
+		!ReadValue(ifs, &initialState) || !ReadValue(ifs, &finalStatesCount) || !ReadValue(ifs, &transitionsCount))
+		return false;
+
+	if (indexes < states || (states && initialState >= indexes) || (!states && (initialState || finalStatesCount || transitionsCount)) ||
+		finalStatesCount > indexes || transitionsCount > static_cast<uint64>(indexes) * 256)
+		return false;
+
+	// Nothing is reserved from the counts, a foreign header fails on the end of the file instead.
+	StatesVector finalStates;
+	TransitionsVector transitions;
+
+	for (uint32 i = 0; i < finalStatesCount; ++i)
+	{
+		uint32 finalState;
+
+		if (!ReadValue(ifs, &finalState) || finalState >= indexes)
+			return false;
+
+		finalStates.push_back(finalState);
+	}
+
+	for (uint64 i = 0; i < transitionsCount; ++i)
+	{
+		uint32 currentState, nextState;
+		char key;
+
+		if (!ReadValue(ifs, &currentState) || !ReadValue(ifs, &key) || !ReadValue(ifs, &nextState) ||
+			currentState >= indexes || nextState >= indexes)
+			return false;
+
+		transitions.emplace_back(TransitionPair(currentState, key), nextState);
+	}
+
+	if (ifs.peek() != std::ifstream::traits_type::eof())
+		return false;
+
+	std::sort(transitions.begin(), transitions.end());
+
+	for (uint32 i = 1; i < transitions.size(); ++i)
+		if (transitions[i - 1].first == transitions[i].first)
+			return false;
+
+	if (!states)
+		*dfa = DeterministicFiniteAutomata();
+	else
+		*dfa = DeterministicFiniteAutomata(states, initialState, std::move(finalStates), TransitionTable(states, std::move(transitions)));
+
+	return true;
+}
+
+void DeterministicFiniteAutomata::WriteBinaryHeader(std::ofstream& ofs, uint32 const& states, uint32 const& indexes, uint32 const& initialState,
+	uint32 const& finalStates, uint64 const& transitions)
+{
+	WriteValue(ofs, BinaryMagic);
+	WriteValue(ofs, states);
+	WriteValue(ofs, indexes);
+	WriteValue(ofs, initialState);
+	WriteValue(ofs, finalStates);
+	WriteValue(ofs, transitions);
+}
+
+void DeterministicFiniteAutomata::WriteBinaryTransition(std::ofstream& ofs, uint32 const& currentState, char const& key, uint32 const& nextState)
+{
+	WriteValue(ofs, currentState);
+	WriteValue(ofs, key);
+	WriteValue(ofs, nextState);
+}
+
+DeterministicFiniteAutomata& DeterministicFiniteAutomata::operator=(DeterministicFiniteAutomata const& source)
+{
+	FiniteAutomata::operator=(source);
+	_shuffleMatcher = std::atomic_load(&source._shuffleMatcher);
+
+	return *this;
+}
+
+DeterministicFiniteAutomata& DeterministicFiniteAutomata::operator=(DeterministicFiniteAutomata&& source)
+{
+	FiniteAutomata::operator=(std::move(source));
+	_shuffleMatcher = std::move(source._shuffleMatcher);
+
+	return *this;
+}
+
+std::shared_ptr<ShuffleMatcher const> DeterministicFiniteAutomata::GetShuffleMatcher() const
+{
+	std::shared_ptr<ShuffleMatcherCache const> cache = std::atomic_load(&_shuffleMatcher);
+
+	// Concurrent matches may both build it, the last one stored is kept.
+	if (!cache)
+	{
+		std::shared_ptr<ShuffleMatcherCache> built = std::make_shared<ShuffleMatcherCache>();
+
+		if (ShuffleMatcher::CanMatch(*this))
+			built->matcher.reset(new ShuffleMatcher(*this));
+
+		cache = built;
+		std::atomic_store(&_shuffleMatcher, cache);
+	}
+
+	return std::shared_ptr<ShuffleMatcher const>(cache, cache->matcher.get());
+}
+
@@ -1,55 +1,113 @@
-#ifndef LFA_LIB_DETERMINISTIC_FINITE_AUTOMATA_H
-#define LFA_LIB_DETERMINISTIC_FINITE_AUTOMATA_H
-
-#include "PCH.h"
-#include "FiniteAutomata.h"
-#include "RegularExpression.h"
-
-class DeterministicFiniteAutomata : public FiniteAutomata
-{
-	public:
-		DeterministicFiniteAutomata() : FiniteAutomata() { }
-		DeterministicFiniteAutomata(std::ifstream& ifs);
-		DeterministicFiniteAutomata(DeterministicFiniteAutomata const& source) : FiniteAutomata(source) { }
-		DeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
-			StatesVector const& finalStates, TransitionMap const& transitionFunction) : 
-			FiniteAutomata(states, initialState, finalStates, transitionFunction) { }
-
-		void Reverse() override;
-		
-		void Minimize(bool usingHopcroft = true);
-
-		bool IsAccepted(String const& word) const override;
-
-		String GenerateWord(uint32 const& length) const override;
-		String GetRegularExpression() const;
-
-		Vector<Vector<bool>> GetEquivalenceMatrix() const;
-
-		Vector<Vector<String>> GetCoefficientsMatrix() const;
-		Vector<Vector<String>> GetFreeTermsMatrix() const;
-
-	private:
-		bool GenerateWord(uint32 const& currentState, uint32 length, String* word) const;
-
-		// Used in GetRegularExpression
-		void ApplyArdensLemma(uint32 const& index, 
-			Vector<Vector<String>>* coefficientsMatrix,	Vector<Vector<String>>* freeTermsMatrix) const;
-		void ApplyArdensLemma(String const& regex, String* freeTerm) const;
-		void EliminateState(uint32 const& index, 
-			Vector<Vector<String>>* coefficientsMatrix,	Vector<Vector<String>>* freeTermsMatrix) const;
-
-		// Used in Minimize
-		Vector<Pair<StatesSet, bool>> BuildMooreMinimalStates() const;	// StatesVector are build using Moore's algorithm in O(N^2) time.
-		Vector<Pair<StatesSet, bool>> BuildHopcroftMinimalStates() const;	// StatesVector are build using Hopcroft's algorithm in O(NlogN) time.
-
-		StatesSet GetPredeccesors(StatesSet const& statesSet, char const& key) const;
-
-		Pair<StatesSet, bool> MoveTo(Vector<Pair<StatesSet, bool>> const& powerSetStates, 
-			Pair<StatesSet, bool> const& states, char const& key) const;
-};
-
-typedef DeterministicFiniteAutomata DFA;
-
-#endif
-
+#ifndef LFA_LIB_DETERMINISTIC_FINITE_AUTOMATA_H
+#define LFA_LIB_DETERMINISTIC_FINITE_AUTOMATA_H
+
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "RegularExpression.h"
+
+class ShuffleMatcher;
+
+class DeterministicFiniteAutomata : public FiniteAutomata
+{
+	public:
+		DeterministicFiniteAutomata() : FiniteAutomata() { }
+		DeterministicFiniteAutomata(std::ifstream& ifs);
+		DeterministicFiniteAutomata(DeterministicFiniteAutomata const& source) : FiniteAutomata(source),
+			_shuffleMatcher(std::atomic_load(&source._shuffleMatcher)) { }
+		DeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector const& finalStates, TransitionMap const& transitionFunction) : 
+			FiniteAutomata(states, initialState, finalStates, transitionFunction) { }
+		DeterministicFiniteAutomata(DeterministicFiniteAutomata&& source) : FiniteAutomata(std::move(source)),
+			_shuffleMatcher(std::move(source._shuffleMatcher)) { }
+		DeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector const& finalStates, TransitionTable const& transitionTable) : 
+			FiniteAutomata(states, initialState, finalStates, transitionTable) { assert(transitionTable.IsDeterministic()); }
+		DeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector&& finalStates, TransitionTable&& transitionTable) : 
+			FiniteAutomata(states, initialState, std::move(finalStates), std::move(transitionTable)) { assert(GetTransitionTable().IsDeterministic()); }
+
+		void Reverse() override;
+		
+		void Minimize(bool usingHopcroft = true);
+
+		bool IsAccepted(String const& word) const override;
+		Vector<bool> IsAccepted(Vector<String> const& words) const;
+
+		// Walks sorted words as the paths of a trie, so a prefix shared with the previous word is not matched again
+		// and the words extending a prefix without a transition are rejected at once. The transitions taken are
+		// the edges of the trie instead of the sum of the word lengths. Unsorted words are still answered, only slower.
+		Vector<bool> AreAcceptedSorted(Vector<String> const& words) const;
+
+		// Profiling mode, adds the visits of every state on the path of word to *profile.
+		bool IsAccepted(String const& word, VisitProfile* profile) const;
+
+		// Splits word in chunks matched in parallel from every state they can start in,
+		// then composes the per chunk state mappings. 0 threads uses every hardware thread.
+		bool IsAcceptedParallel(String const& word, uint32 threads = 0) const;
+
+		String GenerateWord(uint32 const& length) const override;
+		String GetRegularExpression() const;
+
+		Vector<Vector<bool>> GetEquivalenceMatrix() const;
+
+		Vector<Vector<String>> GetCoefficientsMatrix() const;
+		Vector<Vector<RegularExpression::Term>> GetFreeTermsMatrix() const;	// Only the empty word for final states.
+
+		// Writes the automaton in a binary format which keeps every symbol, whitespace included.
+		// The stream has to be opened with std::ios::binary.
+		void WriteBinary(std::ofstream& ofs) const;
+
+		// Reads a file of WriteBinary. Returns false and leaves *dfa as it was if the file is
+		// truncated, in another format or not a DFA.
+		static bool ReadBinary(std::ifstream& ifs, DeterministicFiniteAutomata* dfa);
+
+		// The parts of the binary format, in native byte order: the header, one uint32 per final state,
+		// then one fixed width record per transition. Every state index is below indexes, which is above
+		// the states count when states were removed without renumbering the others.
+		static void WriteBinaryHeader(std::ofstream& ofs, uint32 const& states, uint32 const& indexes, uint32 const& initialState,
+			uint32 const& finalStates, uint64 const& transitions);
+		static void WriteBinaryTransition(std::ofstream& ofs, uint32 const& currentState, char const& key, uint32 const& nextState);
+
+		DeterministicFiniteAutomata& operator=(DeterministicFiniteAutomata const& source);
+		DeterministicFiniteAutomata& operator=(DeterministicFiniteAutomata&& source);
+
+	protected:
+		void OnChanged() override { _shuffleMatcher.reset(); }
+
+	private:
+		struct ShuffleMatcherCache
+		{
+			std::unique_ptr<ShuffleMatcher const> matcher;	// Null when the automaton does not fit a ShuffleMatcher.
+		};
+
+		// Built on the first match which can use it and shared by the copies until they change.
+		// Concurrent matches read and set it with the atomic shared_ptr functions.
+		mutable std::shared_ptr<ShuffleMatcherCache const> _shuffleMatcher;
+
+		// Null when the automaton does not fit a ShuffleMatcher. The pointer keeps the matcher alive.
+		std::shared_ptr<ShuffleMatcher const> GetShuffleMatcher() const;
+
+		bool GenerateWord(uint32 const& currentState, uint32 length, String* word) const;
+
+		// Used in GetRegularExpression
+		void ApplyArdensLemma(uint32 const& index, 
+			Vector<Vector<String>>* coefficientsMatrix,	Vector<Vector<RegularExpression::Term>>* freeTermsMatrix) const;
+		void ApplyArdensLemma(String const& regex, String* coefficient) const;
+		void ApplyArdensLemma(String const& regex, RegularExpression::Term* freeTerm) const;
+		void EliminateState(uint32 const& index, 
+			Vector<Vector<String>>* coefficientsMatrix,	Vector<Vector<RegularExpression::Term>>* freeTermsMatrix) const;
+
+		// Used in Minimize
+		Vector<Pair<StatesSet, bool>> BuildMooreMinimalStates() const;	// StatesVector are build using Moore's algorithm in O(N^2) time.
+		Vector<Pair<StatesSet, bool>> BuildHopcroftMinimalStates() const;	// StatesVector are build using Hopcroft's algorithm in O(NlogN) time.
+
+		StatesSet GetPredeccesors(StatesSet const& statesSet, char const& key) const;
+
+		Pair<StatesSet, bool> MoveTo(Vector<Pair<StatesSet, bool>> const& powerSetStates, 
+			Pair<StatesSet, bool> const& states, char const& key) const;
+};
+
+typedef DeterministicFiniteAutomata DFA;
+
+#endif
+
@@ -0,0 +1,118 @@
+#include "PCH.h"
+#include "DictionaryBuilder.h"
+#include "TransitionTable.h"
+#include "Statistics.h"
+
+void DictionaryBuilder::Add(String const& word)
+{
+	assert(_empty || !(word < _lastWord));
+
+	if (!_empty && word == _lastWord)
+		return;
+
+	uint32 prefix = 0;
+
+	while (prefix < word.size() && prefix < _lastWord.size() && word[prefix] == _lastWord[prefix])
+		++prefix;
+
+	ReplaceOrRegister(prefix);
+
+	for (uint32 i = prefix; i < word.size(); ++i)
+	{
+		uint32 state = NewState();
+		_states[_path.back()].second.emplace_back(word[i], state);
+		_path.push_back(state);
+	}
+
+	_states[_path.back()].first = true;
+	_lastWord = word;
+	_empty = false;
+}
+
+DFA DictionaryBuilder::Build()
+{
+	LFA_STATISTICS_OPERATION("DictionaryBuilder::Build");
+
+	ReplaceOrRegister(0);
+
+	// Number the states in breadth-first order from the root, skipping the free slots.
+	StatesVector numbering(_states.size(), TransitionTable::InvalidState);
+	StatesVector order(1, _path.front());
+	StatesVector finalStates;
+	TransitionsVector transitions;
+
+	numbering[_path.front()] = 0;
+
+	for (uint32 i = 0; i < order.size(); ++i)
+	{
+		StateSignature const& state = _states[order[i]];
+
+		if (state.first)
+			finalStates.push_back(i);
+
+		for (EdgesVector::const_iterator itr = state.second.begin(); itr != state.second.end(); ++itr)
+		{
+			if (numbering[itr->second] == TransitionTable::InvalidState)
+			{
+				numbering[itr->second] = static_cast<uint32>(order.size());
+				order.push_back(itr->second);
+			}
+
+			transitions.emplace_back(TransitionPair(i, itr->first), numbering[itr->second]);
+		}
+	}
+
+	uint32 const states = static_cast<uint32>(order.size());
+	DFA dfa(states, 0, std::move(finalStates), TransitionTable(states, std::move(transitions)));
+	Clear();
+
+	return dfa;
+}
+
+void DictionaryBuilder::Clear()
+{
+	_states.assign(1, StateSignature(false, EdgesVector()));
+	_freeStates.clear();
+	_register.clear();
+	_path.assign(1, 0);
+	_lastWord.clear();
+	_empty = true;
+}
+
+uint32 DictionaryBuilder::NewState()
+{
+	if (_freeStates.empty())
+	{
+		_states.emplace_back(false, EdgesVector());
+		return static_cast<uint32>(_states.size() - 1);
+	}
+
+	uint32 state = _freeStates.back();
+	_freeStates.pop_back();
+
+	return state;
+}
+
+void DictionaryBuilder::ReplaceOrRegister(uint32 const& length)
+{
+	// Children are replaced before their parents so their signatures are final when looked up.
+	while (_path.size() > length + 1)
+	{
+		uint32 state = _path.back();
+		_path.pop_back();
+
+		Map<StateSignature, uint32>::const_iterator itr = _register.find(_states[state]);
+
+		if (itr == _register.end())
+		{
+			_register.emplace(_states[state], state);
+			continue;
+		}
+
+		// The edge to state is the last one added to its parent.
+		_states[_path.back()].second.back().second = itr->second;
+		_states[state] = StateSignature(false, EdgesVector());
+		_freeStates.push_back(state);
+	}
+}
+
@@ -0,0 +1,40 @@
+#ifndef LFA_LIB_DICTIONARY_BUILDER_H
+#define LFA_LIB_DICTIONARY_BUILDER_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+
+// Builds the minimal DFA of a list of words given in lexicographic order,
+// using the incremental algorithm of Daciuk, Mihov, Watson and Watson.
+// Only the states on the path of the last word are not minimal yet. Every other state is
+// kept once in a register of unique states, so memory stays proportional to the minimal DFA.
+class DictionaryBuilder
+{
+	public:
+		DictionaryBuilder() { Clear(); }
+
+		// word must not be lexicographically smaller than the previous one. Duplicates are ignored.
+		void Add(String const& word);
+
+		// Returns the minimal DFA of the words added so far and clears the builder.
+		DFA Build();
+
+		void Clear();
+
+	private:
+		typedef Vector<Pair<char, uint32>> EdgesVector;		// (symbol, state), in insertion order.
+		typedef Pair<bool, EdgesVector> StateSignature;		// (final, edges)
+
+		Vector<StateSignature> _states;
+		StatesVector _freeStates;						// Slots of states replaced by a registered one.
+		Map<StateSignature, uint32> _register;
+		StatesVector _path;								// States along the last word, _path[0] is the root.
+		String _lastWord;
+		bool _empty;
+
+		uint32 NewState();
+		void ReplaceOrRegister(uint32 const& length);	// Minimizes the path of the last word past length.
+};
+
+#endif
+
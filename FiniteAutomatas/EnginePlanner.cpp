@@ -0,0 +1,375 @@
+#include "PCH.h"
+#include "EnginePlanner.h"
+#include "TransitionTable.h"
+#include "ShuffleMatcher.h"
+#include "Statistics.h"
+
+uint32 const EnginePlanner::SampledSubsets;
+uint64 const EnginePlanner::DefaultMemoryBudget;
+
+namespace
+{
+	// Rough bytes of a Map node, of a DFA transition while it is built (its TransitionsVector entry
+	// and its TransitionTable edge) and of a CompressedTable slot.
+	double const MapNodeMemoryUsage = 64.0;
+	double const DFATransitionMemoryUsage = 17.0;
+	double const TableTransitionMemoryUsage = 8.0;
+
+	// The Hopcroft refinement works on sets of states, Moore on an array of pairs.
+	double const HopcroftConstant = 8.0;
+
+	StatesVector GetFinalStatesVector(FiniteAutomata const& automaton)
+	{
+		StatesSet const finalStates = automaton.GetFinalStates();
+		return StatesVector(finalStates.begin(), finalStates.end());
+	}
+
+	NFA GetNFA(FiniteAutomata const& automaton)
+	{
+		return NFA(automaton.GetStatesCount(), automaton.GetInitialState(), GetFinalStatesVector(automaton),
+			automaton.GetTransitionTable(), automaton.GetLambdaTable());
+	}
+
+	// Subset construction from the states in initialSubset, stopped once limit subsets are found.
+	// The subsets are closed over the lambda transitions of lambdaTable, unless it is null.
+	// Returns whether it finished. *subsetsStates is the sum of the sizes of the subsets found.
+	bool SampleSubsets(TransitionTable const& table, TransitionTable const* lambdaTable, Set<char> const& alphabet,
+		StatesVector initialSubset, uint32 const& limit, uint64* subsets, uint64* subsetsStates)
+	{
+		uint32 stamp = 1;
+		StatesVector marks(table.GetStates(), TransitionTable::InvalidState), subset;
+		Set<StatesVector> found;
+		Vector<StatesVector const*> order;
+
+		for (StatesConstIterator itr = initialSubset.begin(); itr != initialSubset.end(); ++itr)
+			marks[*itr] = stamp;
+
+		if (lambdaTable)
+			lambdaTable->AddClosure(FiniteAutomata::Lambda, &initialSubset, &marks, stamp);
+		else
+			std::sort(initialSubset.begin(), initialSubset.end());
+
+		*subsets = 0;
+		*subsetsStates = 0;
+
+		if (initialSubset.empty())
+			return true;
+
+		order.push_back(&*found.insert(initialSubset).first);
+
+		for (uint32 i = 0; i < order.size(); ++i)
+		{
+			if (order.size() >= limit)
+				break;
+
+			for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
+			{
+				subset.clear();
+				table.AddTargets(*order[i], *key, &subset, &marks, ++stamp);
+
+				if (subset.empty())
+					continue;
+
+				if (lambdaTable)
+					lambdaTable->AddClosure(FiniteAutomata::Lambda, &subset, &marks, stamp);
+				else
+					std::sort(subset.begin(), subset.end());
+
+				Pair<Set<StatesVector>::const_iterator, bool> inserted = found.insert(subset);
+
+				if (inserted.second)
+					order.push_back(&*inserted.first);
+			}
+		}
+
+		*subsets = order.size();
+
+		for (uint32 i = 0; i < order.size(); ++i)
+			(*subsetsStates) += order[i]->size();
+
+		return order.size() < limit;
+	}
+
+	String FormatCost(double const& cost)
+	{
+		return std::to_string(static_cast<uint64>(cost));
+	}
+
+	String FormatSubsets(uint64 const& subsets, bool const& exact, double const& averageSize)
+	{
+		char size[32];
+		snprintf(size, sizeof(size), "%.1f", averageSize);
+
+		return (exact ? "" : "at least ") + std::to_string(subsets) + " DFA states, " + size + " states per subset";
+	}
+
+	struct Candidate
+	{
+		ExecutionPlan::Engine engine;
+		double cost;
+	};
+}
+
+char const* ExecutionPlan::GetEngineName(Engine const& engine)
+{
+	switch (engine)
+	{
+		case ENGINE_NFA_SIMULATION:
+			return "NFA simulation";
+		case ENGINE_LAZY_DFA:
+			return "lazy DFA";
+		case ENGINE_DFA:
+			return "DFA";
+		case ENGINE_DFA_TABLE:
+			return "DFA table";
+	}
+
+	return "";
+}
+
+char const* ExecutionPlan::GetMinimizationName(Minimization const& minimization)
+{
+	switch (minimization)
+	{
+		case MINIMIZATION_NONE:
+			return "none";
+		case MINIMIZATION_HOPCROFT:
+			return "Hopcroft";
+		case MINIMIZATION_MOORE:
+			return "Moore";
+		case MINIMIZATION_BRZOZOWSKI:
+			return "Brzozowski";
+	}
+
+	return "";
+}
+
+AutomataProfile EnginePlanner::GetProfile(FiniteAutomata const& automaton, bool sampleReverse)
+{
+	AutomataProfile profile;
+
+	if (!automaton.HasStates())
+		return profile;
+
+	LFA_STATISTICS_OPERATION("EnginePlanner::GetProfile");
+
+	TransitionTable const& table = automaton.GetTransitionTable();
+	TransitionTable const& lambdaTable = automaton.GetLambdaTable();
+	bool const lambda = automaton.HasLambdaTransitions();
+	Set<char> const alphabet = automaton.GetAlphabet();
+
+	profile.states = automaton.GetStatesCount();
+	profile.lambdaTransitions = lambdaTable.GetTransitionsCount();
+	profile.transitions = table.GetTransitionsCount() + profile.lambdaTransitions;
+	profile.alphabetSize = static_cast<uint32>(alphabet.size());
+
+	profile.deterministic = table.IsDeterministic() && !profile.lambdaTransitions;
+
+	uint64 subsetsStates;
+
+	if (profile.deterministic)
+	{
+		Vector<bool> const reachable = automaton.GetReachableStates();
+
+		profile.subsets = static_cast<uint64>(std::count(reachable.begin(), reachable.end(), true));
+		profile.averageSubsetSize = 1.0;
+	}
+	else
+	{
+		profile.subsetsExact = SampleSubsets(table, lambda ? &lambdaTable : nullptr, alphabet, StatesVector({ automaton.GetInitialState() }),
+			SampledSubsets, &profile.subsets, &subsetsStates);
+		profile.averageSubsetSize = profile.subsets ? static_cast<double>(subsetsStates) / profile.subsets : 0.0;
+	}
+
+	if (sampleReverse)
+	{
+		TransitionTable const reverseLambda = lambdaTable.GetReverse();
+
+		profile.reverseSubsetsExact = SampleSubsets(table.GetReverse(), lambda ? &reverseLambda : nullptr, alphabet,
+			GetFinalStatesVector(automaton), SampledSubsets, &profile.reverseSubsets, &subsetsStates);
+		profile.averageReverseSubsetSize = profile.reverseSubsets ? static_cast<double>(subsetsStates) / profile.reverseSubsets : 0.0;
+	}
+
+	return profile;
+}
+
+ExecutionPlan EnginePlanner::GetPlan(FiniteAutomata const& automaton, WorkloadHints const& hints)
+{
+	ExecutionPlan plan;
+	AutomataProfile const& profile = plan.profile = GetProfile(automaton, hints.needsMinimalDFA);
+
+	plan.memoryBudget = hints.memoryBudget ? hints.memoryBudget : DefaultMemoryBudget;
+	plan.reasons.push_back(std::to_string(profile.states) + " states, " + std::to_string(profile.transitions) + " transitions over " +
+		std::to_string(profile.alphabetSize) + " symbols, " + std::to_string(profile.lambdaTransitions) + " lambda transitions, " +
+		(profile.deterministic ? "deterministic" : "not deterministic"));
+
+	if (!profile.deterministic)
+		plan.reasons.push_back("subset construction: " + FormatSubsets(profile.subsets, profile.subsetsExact, profile.averageSubsetSize));
+
+	double const states = std::max(profile.states, 1u);
+	double const alphabet = std::max(profile.alphabetSize, 1u);
+	double const input = static_cast<double>(hints.queries) * hints.averageWordLength;
+	double const budget = hints.memoryBudget ? static_cast<double>(hints.memoryBudget) : HUGE_VAL;
+
+	// Building one DFA transition merges the moves of every state of the subset.
+	double const subsetStep = std::max(profile.averageSubsetSize, 1.0) * (1.0 + (profile.transitions + profile.lambdaTransitions) / states);
+	double const dfaStates = static_cast<double>(std::max<uint64>(profile.subsets, 1));
+	double const dfaTransitions = dfaStates * alphabet;
+	double const determinization = profile.deterministic ? profile.transitions :
+		dfaTransitions * (subsetStep + log2(dfaStates + 1));
+	bool const dfaKnown = profile.deterministic || profile.subsetsExact;
+
+	if (!hints.needsMinimalDFA)
+		plan.reasons.push_back("minimization: none, matching does not need the minimal DFA");
+	else
+	{
+		// A DFA is minimized in place, Brzozowski runs two determinizations whose second one
+		// is bounded by the minimal DFA, so it is estimated like the first one.
+		double const hopcroft = dfaKnown ? determinization + HopcroftConstant * dfaTransitions * log2(dfaStates + 1) : -1.0;
+		double const moore = dfaKnown && dfaStates * dfaStates / 8 <= budget ? determinization + dfaTransitions * dfaStates : -1.0;
+		double const brzozowski = profile.reverseSubsetsExact ? 2.0 * std::max<uint64>(profile.reverseSubsets, 1) * alphabet *
+			std::max(profile.averageReverseSubsetSize, 1.0) * (1.0 + (profile.transitions + profile.lambdaTransitions) / states) : -1.0;
+
+		plan.reasons.push_back("reversed subset construction: " + FormatSubsets(profile.reverseSubsets, profile.reverseSubsetsExact,
+			profile.averageReverseSubsetSize));
+
+		if (hopcroft >= 0.0)
+			plan.reasons.push_back("Hopcroft: cost " + FormatCost(hopcroft));
+
+		if (moore >= 0.0)
+			plan.reasons.push_back("Moore: cost " + FormatCost(moore));
+
+		if (brzozowski >= 0.0)
+			plan.reasons.push_back("Brzozowski: cost " + FormatCost(brzozowski));
+
+		if (brzozowski >= 0.0 && (hopcroft < 0.0 || brzozowski < hopcroft) && (moore < 0.0 || brzozowski < moore))
+			plan.minimization = ExecutionPlan::MINIMIZATION_BRZOZOWSKI;
+		else if (moore >= 0.0 && moore < hopcroft)
+			plan.minimization = ExecutionPlan::MINIMIZATION_MOORE;
+		else
+			plan.minimization = ExecutionPlan::MINIMIZATION_HOPCROFT;
+
+		if (hopcroft < 0.0 && brzozowski < 0.0)
+			plan.reasons.push_back("minimization: Hopcroft, both determinizations outgrow the sample and ToDFA is needed anyway");
+		else
+			plan.reasons.push_back(String("minimization: ") + ExecutionPlan::GetMinimizationName(plan.minimization) + ", the cheapest");
+	}
+
+	Vector<Candidate> candidates;
+
+	// A deterministic automaton is simulated with a single state, which is what the DFA engines do.
+	if (!profile.deterministic)
+	{
+		double const simulation = profile.transitions + input * subsetStep;
+
+		// Every symbol of the input builds at most one transition, the others are cached. A DFA larger than
+		// the sample is assumed to be walked within what the cache holds, HybridMatcher keeps 256 targets per state.
+		double const lazyStateMemoryUsage = 256 * sizeof(uint32) + std::max(profile.averageSubsetSize, 1.0) * sizeof(uint32) + MapNodeMemoryUsage;
+		double const built = std::min(input, profile.subsetsExact ? dfaTransitions : plan.memoryBudget / lazyStateMemoryUsage * alphabet);
+		double const lazy = built * subsetStep + 2.0 * input;
+
+		candidates.push_back({ ExecutionPlan::ENGINE_NFA_SIMULATION, simulation });
+		candidates.push_back({ ExecutionPlan::ENGINE_LAZY_DFA, lazy });
+	}
+
+	if (!dfaKnown)
+		plan.reasons.push_back("DFA engines: skipped, the DFA size is unknown, the lazy DFA builds only what the input needs");
+	else if (!profile.deterministic && dfaTransitions * DFATransitionMemoryUsage > budget)
+		plan.reasons.push_back("DFA engines: skipped, the DFA does not fit in the memory budget");
+	else
+	{
+		// Minimizing costs the same for both DFA engines, so it is left out of the comparison. A DFA that
+		// fits a ShuffleMatcher is matched by one shuffle per symbol once the matcher is built from its transitions.
+		// A deterministic automaton is counted with its unreachable states, which it may keep.
+		double const dfaRows = profile.deterministic ? states : dfaStates;
+
+		if (dfaRows < ShuffleMatcher::Lanes)
+		{
+			plan.reasons.push_back("DFA: shuffle matcher, " + std::to_string(static_cast<uint32>(dfaRows)) + " states fit in " +
+				std::to_string(ShuffleMatcher::Lanes - 1) + " lanes");
+			candidates.push_back({ ExecutionPlan::ENGINE_DFA, determinization + dfaTransitions + input });
+		}
+		else
+			candidates.push_back({ ExecutionPlan::ENGINE_DFA, determinization + input * log2(dfaTransitions + 1) });
+
+		if (dfaTransitions * (DFATransitionMemoryUsage + TableTransitionMemoryUsage) <= budget)
+			candidates.push_back({ ExecutionPlan::ENGINE_DFA_TABLE, determinization + dfaStates * 256 + input });
+		else
+			plan.reasons.push_back("DFA table: skipped, the DFA and its table do not fit in the memory budget together");
+	}
+
+	Vector<Candidate>::const_iterator best = candidates.begin();
+
+	for (Vector<Candidate>::const_iterator itr = candidates.begin(); itr != candidates.end(); ++itr)
+	{
+		plan.reasons.push_back(String(ExecutionPlan::GetEngineName(itr->engine)) + ": cost " + FormatCost(itr->cost));
+
+		if (itr->cost < best->cost)
+			best = itr;
+	}
+
+	plan.engine = best->engine;
+	plan.estimatedCost = best->cost;
+	plan.reasons.push_back(String("engine: ") + ExecutionPlan::GetEngineName(plan.engine) + ", the cheapest for " +
+		std::to_string(hints.queries) + " queries of " + std::to_string(hints.averageWordLength) + " symbols");
+
+	return plan;
+}
+
+DFA EnginePlanner::GetDFA(FiniteAutomata const& automaton, ExecutionPlan const& plan)
+{
+	if (plan.minimization == ExecutionPlan::MINIMIZATION_BRZOZOWSKI)
+		return automaton.GetMinimalDFA();
+
+	// A deterministic NFA has no lambda transitions, so its symbols mean the same in a DFA.
+	DFA dfa = plan.profile.deterministic ? DFA(automaton.GetStatesCount(), automaton.GetInitialState(),
+		GetFinalStatesVector(automaton), automaton.GetTransitionTable()) : GetNFA(automaton).ToDFA();
+
+	if (plan.minimization != ExecutionPlan::MINIMIZATION_NONE)
+		dfa.Minimize(plan.minimization == ExecutionPlan::MINIMIZATION_HOPCROFT);
+
+	return dfa;
+}
+
+PlannedMatcher::PlannedMatcher(FiniteAutomata const& automaton, WorkloadHints const& hints) : _plan(EnginePlanner::GetPlan(automaton, hints))
+{
+	Build(automaton);
+}
+
+PlannedMatcher::PlannedMatcher(FiniteAutomata const& automaton, ExecutionPlan const& plan) : _plan(plan)
+{
+	Build(automaton);
+}
+
+void PlannedMatcher::Build(FiniteAutomata const& automaton)
+{
+	LFA_STATISTICS_OPERATION("PlannedMatcher::Build");
+
+	switch (_plan.engine)
+	{
+		case ExecutionPlan::ENGINE_NFA_SIMULATION:
+			_compiled = CompiledAutomata::Compile(automaton);
+			break;
+		case ExecutionPlan::ENGINE_LAZY_DFA:
+			_lazy.reset(new HybridMatcher(GetNFA(automaton), _plan.memoryBudget));
+			break;
+		case ExecutionPlan::ENGINE_DFA:
+			_dfa = EnginePlanner::GetDFA(automaton, _plan);
+			break;
+		case ExecutionPlan::ENGINE_DFA_TABLE:
+			_compiled = CompiledAutomata::Compile(EnginePlanner::GetDFA(automaton, _plan));
+			break;
+	}
+}
+
+bool PlannedMatcher::IsAccepted(String const& word)
+{
+	if (_lazy)
+		return _lazy->IsAccepted(word);
+
+	if (_compiled)
+		return _compiled->IsAccepted(word, &_scratch);
+
+	return _dfa.IsAccepted(word);
+}
+
@@ -0,0 +1,115 @@
+#ifndef LFA_LIB_ENGINE_PLANNER_H
+#define LFA_LIB_ENGINE_PLANNER_H
+
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "DeterministicFiniteAutomata.h"
+#include "NondeterministicFiniteAutomata.h"
+#include "CompiledAutomata.h"
+#include "HybridMatcher.h"
+
+// What the caller expects to do with the automaton.
+struct WorkloadHints
+{
+	uint64 queries;				// Words matched against the automaton.
+	uint64 averageWordLength;
+	uint64 memoryBudget;		// Bytes the matcher may use, 0 for no limit.
+	bool needsMinimalDFA;		// The minimal DFA is wanted for itself, to be saved or compared.
+
+	WorkloadHints() : queries(1), averageWordLength(16), memoryBudget(0), needsMinimalDFA(false) { }
+};
+
+struct AutomataProfile
+{
+	uint32 states;
+	uint32 transitions;
+	uint32 alphabetSize;
+	uint32 lambdaTransitions;
+	bool deterministic;			// No lambda transitions and a single target per transition.
+
+	// Subset construction is run for at most EnginePlanner::SampledSubsets subsets. If it stops there
+	// the count is a lower bound of the DFA states and the average subset size is the one of the sample.
+	uint64 subsets;
+	bool subsetsExact;
+	double averageSubsetSize;
+
+	// Same for the reversed automaton, the first determinization of Brzozowski's algorithm.
+	uint64 reverseSubsets;
+	bool reverseSubsetsExact;
+	double averageReverseSubsetSize;
+
+	AutomataProfile() : states(0), transitions(0), alphabetSize(0), lambdaTransitions(0), deterministic(true),
+		subsets(0), subsetsExact(true), averageSubsetSize(0.0), reverseSubsets(0), reverseSubsetsExact(true), averageReverseSubsetSize(0.0) { }
+};
+
+struct ExecutionPlan
+{
+	enum Engine
+	{
+		ENGINE_NFA_SIMULATION,	// CompiledAutomata over the transition table, one subset per symbol.
+		ENGINE_LAZY_DFA,		// HybridMatcher, DFA states built while matching within the budget.
+		ENGINE_DFA,				// DFA::IsAccepted, a ShuffleMatcher kept with the DFA when it fits, else the transition table.
+		ENGINE_DFA_TABLE		// CompiledAutomata over the CompressedTable of the DFA.
+	};
+
+	enum Minimization
+	{
+		MINIMIZATION_NONE,
+		MINIMIZATION_HOPCROFT,
+		MINIMIZATION_MOORE,
+		MINIMIZATION_BRZOZOWSKI
+	};
+
+	Engine engine;
+	Minimization minimization;	// Of the DFA the engine is built from, or of the minimal DFA asked for.
+	double estimatedCost;		// Transition lookups, roughly.
+	uint64 memoryBudget;		// Of the lazy DFA cache.
+	AutomataProfile profile;
+	Vector<String> reasons;		// Why, one line per fact or comparison, in the order they were considered.
+
+	ExecutionPlan() : engine(ENGINE_NFA_SIMULATION), minimization(MINIMIZATION_NONE), estimatedCost(0.0), memoryBudget(0) { }
+
+	static char const* GetEngineName(Engine const& engine);
+	static char const* GetMinimizationName(Minimization const& minimization);
+};
+
+// Picks the cheapest way to match words against an automaton, and to minimize it when asked,
+// from the shape of the automaton and the workload. The costs are rough counts of transition
+// lookups from the complexity of each algorithm, they only have to rank the choices.
+class EnginePlanner
+{
+	public:
+		static uint32 const SampledSubsets = 4096;
+		static uint64 const DefaultMemoryBudget = 64 << 20;	// Of the lazy DFA when the hints set none.
+
+		// The reversed automaton is only sampled with sampleReverse.
+		static AutomataProfile GetProfile(FiniteAutomata const& automaton, bool sampleReverse);
+		static ExecutionPlan GetPlan(FiniteAutomata const& automaton, WorkloadHints const& hints);
+
+		// The minimal DFA, built with plan.minimization. MINIMIZATION_NONE determinizes only.
+		static DFA GetDFA(FiniteAutomata const& automaton, ExecutionPlan const& plan);
+};
+
+// Matcher running the engine of a plan.
+class PlannedMatcher
+{
+	public:
+		PlannedMatcher(FiniteAutomata const& automaton, WorkloadHints const& hints);
+		PlannedMatcher(FiniteAutomata const& automaton, ExecutionPlan const& plan);
+
+		ExecutionPlan const& GetPlan() const { return _plan; }
+
+		bool IsAccepted(String const& word);
+
+	private:
+		ExecutionPlan _plan;
+		DFA _dfa;
+		CompiledAutomataPtr _compiled;
+		std::unique_ptr<HybridMatcher> _lazy;
+		CompiledAutomata::Scratch _scratch;
+
+		void Build(FiniteAutomata const& automaton);
+};
+
+#endif
+
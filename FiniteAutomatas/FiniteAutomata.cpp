@@ -1,244 +1,943 @@
-#include "PCH.h"
-#include "FiniteAutomata.h"
-#include "NondeterministicFiniteAutomata.h"
-
-void FiniteAutomata::RemoveState(uint32 const& state)
-{
-	if (!HasStates())
-		return;
-
-	// Remove it from finalStates vector if it is a final state
-	for (StatesConstIterator itr = _finalStates.begin(); itr != _finalStates.end(); ++itr)
-		if ((*itr) == state)
-		{
-			_finalStates.erase(itr);
-			break;
-		}
-
-	// Remove all its references from transition function
-	TransitionMap::iterator itr = _transitionFunction.begin();
-	while (itr != _transitionFunction.end())
-	{
-		if (itr->first.first == state)
-		{
-			_transitionFunction.erase(itr++);
-			continue;
-		}
-
-		bool emptyTransition = false;
-
-		for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
-			if ((*iter) == state)
-			{
-				itr->second.erase(iter);
-
-				if (itr->second.empty())
-					emptyTransition = true;
-
-				break;
-			}
-
-		if (emptyTransition)
-		{
-			_transitionFunction.erase(itr++);
-			continue;
-		}
-
-		++itr;
-	}
-
-	_states--;
-}
-
-void FiniteAutomata::RemoveUnreachableStates()
-{
-	if (!HasStates())
-		return;
-
-	if (!HasTransitions())
-	{
-		_states = 1;	// Only the initial state is reachable.
-
-		if (IsFinalState(_initialState))
-		{
-			_finalStates.~vector();
-			_finalStates.push_back(_initialState);
-		}
-		else
-			_finalStates.~vector();
-	}
-
-	Vector<bool> reachableStates = GetReachableStates();
-
-	for (uint32 i = 0; i < reachableStates.size(); ++i)
-		if (!reachableStates[i])
-			RemoveState(i);
-}
-
-void FiniteAutomata::Minimize()
-{
-	// This methods is using Brzozowski's algorithm.
-	// Reverses a FA(either deterministic or nondeterministic)
-	// then converts it to a DFA and then reverses it again.
-	// It can be used for NFA even if it produces a DFA.
-	// NFAs are extensions of DFAs.
-	*this = GetReverse().ToDFA().GetReverse().ToDFA();
-}
-
-StatesSet FiniteAutomata::GetInconclusiveStates() const
-{
-	if (!HasStates())
-		return StatesSet();
-
-	StatesSet inconclusiveStates;
-
-	// We iterate through transition map in case states we're removed from the automaton.
-	for (TransitionMapConstIterator itr = _transitionFunction.cbegin(); itr != _transitionFunction.cend(); ++itr)
-		if (!IsFinalState(itr->first.first))
-			inconclusiveStates.insert(itr->first.first);
-
-	return inconclusiveStates;
-}
-
-StatesSet FiniteAutomata::GetFinalStates() const
-{
-	if (!HasFinalStates())
-		return StatesSet();
-
-	StatesSet finalStates;
-
-	for (StatesConstIterator itr = _finalStates.cbegin(); itr != _finalStates.cend(); ++itr)
-		finalStates.insert(*itr);
-
-	return finalStates;
-}
-
-Set<char> FiniteAutomata::GetAlphabet() const
-{
-	if (!HasStates() || !HasTransitions())
-		return Set<char>();
-
-	Set<char> alphabet;
-
-	for (TransitionMapConstIterator itr = _transitionFunction.begin(); itr != _transitionFunction.end(); ++itr)
-		if (itr->first.second != '0')
-			alphabet.insert(itr->first.second);
-
-	return alphabet;
-}
-
-Vector<bool> FiniteAutomata::GetReachableStates() const
-{
-	if (!HasStates())
-		return Vector<bool>();
-
-	Stack<uint32> stack;
-	Vector<bool> visited(_states, false);
-	
-	stack.push(_initialState);
-	visited[_initialState] = true;
-
-	while (!stack.empty())
-	{
-		uint32 currentState = stack.top();
-		bool found = false;
-
-		for (TransitionMapConstIterator itr = _transitionFunction.begin(); itr != _transitionFunction.end() && !found; ++itr)
-			if (itr->first.first == currentState)
-				for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
-					if (!visited[(*iter)])
-					{
-						stack.push((*iter));
-						visited[(*iter)] = true;
-						found = true;
-						break;
-					}
-
-		if (!found)
-			stack.pop();
-	}
-
-	return visited;
-}
-
-bool FiniteAutomata::IsFinalState(uint32 const& state) const
-{
-	if (!HasStates() || !HasFinalStates())
-		return false;
-
-	for (StatesConstIterator itr = _finalStates.begin(); itr != _finalStates.end(); ++itr)
-		if ((*itr) == state)
-			return true;
-
-	return false;
-}
-
-bool FiniteAutomata::IsFinalState(StatesSet const& state) const
-{
-	if (!HasStates() || !HasFinalStates() || state.empty())
-		return false;
-
-	for (StatesSetConstIterator itr = state.begin(); itr != state.end(); ++itr)
-		if (IsFinalState(*itr))
-			return true;
-
-	return false;
-}
-
-NFA FiniteAutomata::GetReverse() const
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates())
-		return NFA();
-
-	uint32 initialState;
-	StatesVector finalStates;
-	TransitionMap transitionFunction;
-
-	// Reverse transitions
-	for (TransitionMapConstIterator itr = _transitionFunction.begin(); itr != _transitionFunction.end(); ++itr)
-	{
-		for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
-		{
-			TransitionPair pair(*iter, itr->first.second);
-			TransitionMap::iterator iterator = transitionFunction.find(pair);
-
-			if (iterator == transitionFunction.end())
-			{
-				StatesVector transitionStates;
-				transitionStates.push_back(itr->first.first);
-				transitionFunction.emplace(pair, transitionStates);
-			}
-			else
-				iterator->second.push_back(itr->first.first);
-		}
-	}
-
-	// Build initial state
-	if (_finalStates.size() > 1)
-	{
-		initialState = _states;
-		transitionFunction.emplace(std::make_pair(std::make_pair(_states, '0'), _finalStates));
-	}
-	else
-		initialState = _finalStates[0];
-
-	// Build final state
-	finalStates.push_back(_initialState);
-
-	// Build the reversed nfa
-	return NFA((_finalStates.size() > 1) ? _states + 1 : _states, initialState, finalStates, transitionFunction);
-}
-
-FiniteAutomata& FiniteAutomata::operator=(FiniteAutomata const& source)
-{
-	if (this == &source)
-		return *this;
-
-	_states = source._states;
-	_finalStates = source._finalStates;
-	_initialState = source._initialState;
-	_transitionFunction = source._transitionFunction;
-
-	return *this;
-}
-
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "TransitionTable.h"
+#include "DeterministicFiniteAutomata.h"
+#include "NondeterministicFiniteAutomata.h"
+#include "Statistics.h"
+
+namespace
+{
+	// Subset construction of the reverse of an automaton, given only the reversed transition table.
+	// The reversed automaton starts in startStates and accepts in acceptState, so it is never built.
+	// Produces a DFA with initial state 0 and returns its number of states.
+	// The subsets are closed over the reversed lambda transitions of reversedLambda, unless it is null.
+	// subset and marks are scratch buffers reused between calls.
+	uint32 DeterminizeReverse(TransitionTable const& reversed, TransitionTable const* reversedLambda, StatesVector const& startStates,
+		uint32 const& acceptState, StatesVector* finalStates, TransitionsVector* transitions, StatesVector* subset, StatesVector* marks)
+	{
+		Set<char> alphabet;
+
+		for (uint32 edge = 0; edge < reversed.GetEdgesCount(); ++edge)
+			alphabet.insert(reversed.GetSymbol(edge));
+
+		uint32 stamp = 0;
+		Map<StatesVector, uint32> subsetsIndex;
+		Vector<StatesVector const*> subsets;
+
+		finalStates->clear();
+		transitions->clear();
+		marks->assign(reversed.GetStates(), TransitionTable::InvalidState);
+		subset->clear();
+
+		for (StatesConstIterator itr = startStates.begin(); itr != startStates.end(); ++itr)
+			if ((*marks)[*itr] != stamp)
+			{
+				(*marks)[*itr] = stamp;
+				subset->push_back(*itr);
+			}
+
+		if (reversedLambda)
+			reversedLambda->AddClosure(FiniteAutomata::Lambda, subset, marks, stamp);
+		else
+			std::sort(subset->begin(), subset->end());
+
+		subsets.push_back(&subsetsIndex.emplace(*subset, 0).first->first);
+
+		for (uint32 i = 0; i < subsets.size(); ++i)
+		{
+			StatesVector const& current = *subsets[i];
+
+			LFA_STATISTICS_ADD(subsetsExplored, 1);
+			LFA_STATISTICS_ADD(subsetsStates, current.size());
+
+			if (std::binary_search(current.begin(), current.end(), acceptState))
+				finalStates->push_back(i);
+
+			for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
+			{
+				++stamp;
+				subset->clear();
+				reversed.AddTargets(current, *key, subset, marks, stamp);
+
+				if (subset->empty())
+					continue;
+
+				if (reversedLambda)
+					reversedLambda->AddClosure(FiniteAutomata::Lambda, subset, marks, stamp);
+				else
+					std::sort(subset->begin(), subset->end());
+
+				Map<StatesVector, uint32>::const_iterator itr = subsetsIndex.find(*subset);
+
+				if (itr == subsetsIndex.end())
+				{
+					itr = subsetsIndex.emplace(*subset, static_cast<uint32>(subsets.size())).first;
+					subsets.push_back(&itr->first);
+				}
+
+				transitions->emplace_back(TransitionPair(i, *key), itr->second);
+			}
+		}
+
+		return static_cast<uint32>(subsets.size());
+	}
+
+	// Tarjan's algorithm over the states marked in keep, without recursion. Components are numbered
+	// in reverse topological order, so every edge leads to a component with a smaller or equal number.
+	// Returns the number of components, the other states get TransitionTable::InvalidState.
+	uint32 GetComponents(TransitionTable const& table, Vector<bool> const& keep, StatesVector* components)
+	{
+		struct Frame
+		{
+			uint32 state;
+			uint32 edge;
+			uint32 target;	// Index in the targets of edge.
+		};
+
+		uint32 const states = table.GetStates();
+		uint32 counter = 0, count = 0;
+		StatesVector index(states, TransitionTable::InvalidState), lowLink(states, 0), stack;
+		Vector<bool> onStack(states, false);
+		Vector<Frame> frames;
+
+		components->assign(states, TransitionTable::InvalidState);
+
+		auto visit = [&](uint32 const& state)
+		{
+			index[state] = lowLink[state] = counter++;
+			stack.push_back(state);
+			onStack[state] = true;
+			frames.push_back({ state, table.GetEdgesBegin(state), 0 });
+		};
+
+		for (uint32 root = 0; root < states; ++root)
+		{
+			if (!keep[root] || index[root] != TransitionTable::InvalidState)
+				continue;
+
+			visit(root);
+
+			while (!frames.empty())
+			{
+				Frame& frame = frames.back();
+
+				if (frame.edge < table.GetEdgesEnd(frame.state))
+				{
+					TargetsRange targets = table.GetTargets(frame.edge);
+
+					if (targets.first + frame.target == targets.second)
+					{
+						++frame.edge;
+						frame.target = 0;
+						continue;
+					}
+
+					uint32 next = targets.first[frame.target++];
+
+					if (!keep[next])
+						continue;
+
+					if (index[next] == TransitionTable::InvalidState)
+						visit(next);
+					else if (onStack[next])
+						lowLink[frame.state] = std::min(lowLink[frame.state], index[next]);
+
+					continue;
+				}
+
+				uint32 state = frame.state;
+				frames.pop_back();
+
+				if (!frames.empty())
+					lowLink[frames.back().state] = std::min(lowLink[frames.back().state], lowLink[state]);
+
+				if (lowLink[state] != index[state])
+					continue;
+
+				uint32 member;
+
+				do
+				{
+					member = stack.back();
+					stack.pop_back();
+					onStack[member] = false;
+					(*components)[member] = count;
+				}
+				while (member != state);
+
+				++count;
+			}
+		}
+
+		return count;
+	}
+
+	// The transitions of table without the ones from or to state. rows grows to the highest state left.
+	// Returns whether any transition was dropped.
+	bool RemoveTransitions(TransitionTable const& table, uint32 const& state, TransitionsVector* transitions, uint32* rows)
+	{
+		bool referenced = false;
+
+		transitions->reserve(table.GetTransitionsCount());
+
+		for (uint32 current = 0; current < table.GetStates(); ++current)
+			for (uint32 edge = table.GetEdgesBegin(current); edge < table.GetEdgesEnd(current); ++edge)
+			{
+				TargetsRange targets = table.GetTargets(edge);
+
+				for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				{
+					if (current == state || (*itr) == state)
+					{
+						referenced = true;
+						continue;
+					}
+
+					transitions->emplace_back(TransitionPair(current, table.GetSymbol(edge)), *itr);
+					*rows = std::max(*rows, std::max(current, *itr) + 1);
+				}
+			}
+
+		return referenced;
+	}
+
+	// The transitions of table between states kept by numbering, renumbered.
+	void RenumberTransitions(TransitionTable const& table, StatesVector const& numbering, TransitionsVector* transitions)
+	{
+		transitions->reserve(table.GetTransitionsCount());
+
+		for (uint32 state = 0; state < table.GetStates(); ++state)
+		{
+			if (table.GetEdgesBegin(state) == table.GetEdgesEnd(state))
+				continue;
+
+			assert(state < numbering.size());
+
+			if (numbering[state] == TransitionTable::InvalidState)
+				continue;
+
+			for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			{
+				TargetsRange targets = table.GetTargets(edge);
+
+				for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				{
+					assert((*itr) < numbering.size());
+
+					if (numbering[*itr] != TransitionTable::InvalidState)
+						transitions->emplace_back(TransitionPair(numbering[state], table.GetSymbol(edge)), numbering[*itr]);
+				}
+			}
+		}
+	}
+}
+
+char const FiniteAutomata::Lambda = '0';
+
+FiniteAutomata::FiniteAutomata(uint32 const& states, uint32 const& initialState, 
+	StatesVector const& finalStates, TransitionTable const& transitionTable, TransitionTable const& lambdaTable) : 
+	_states(states), _initialState(initialState), _finalStates(finalStates), _transitionTable(transitionTable)
+{
+	assert(GetTransitionTable().GetStates() >= states);
+
+	if (lambdaTable.GetEdgesCount() != 0)
+	{
+		assert(lambdaTable.GetStates() == transitionTable.GetStates());
+		_lambdaTable = lambdaTable;
+	}
+}
+
+void FiniteAutomata::SetTransitions(TransitionsVector transitions, TransitionsVector lambdaTransitions)
+{
+	// Both tables get the same rows, so the states of the lambda transitions have a row in _transitionTable.
+	uint32 rows = _states;
+
+	for (TransitionsVector::iterator itr = lambdaTransitions.begin(); itr != lambdaTransitions.end(); ++itr)
+	{
+		itr->first.second = Lambda;
+		rows = std::max(rows, std::max(itr->first.first, itr->second) + 1);
+	}
+
+	_transitionTable = TransitionTable(rows, std::move(transitions));
+
+	if (lambdaTransitions.empty())
+		_lambdaTable = CopyOnWrite<TransitionTable>();
+	else
+		_lambdaTable = TransitionTable(_transitionTable->GetStates(), std::move(lambdaTransitions));
+}
+
+CopyOnWrite<TransitionTable> FiniteAutomata::GetGraph() const
+{
+	if (!HasLambdaTransitions())
+		return _transitionTable;
+
+	TransitionsVector transitions = _transitionTable->GetTransitions();
+	TransitionsVector const lambdaTransitions = _lambdaTable->GetTransitions();
+
+	transitions.insert(transitions.end(), lambdaTransitions.begin(), lambdaTransitions.end());
+
+	return TransitionTable(_transitionTable->GetStates(), std::move(transitions));
+}
+
+void FiniteAutomata::RemoveState(uint32 const& state)
+{
+	if (!HasStates())
+		return;
+
+	OnChanged();
+
+	// Remove it from finalStates vector if it is a final state
+	// Only the parts which reference the state are written, so copies sharing the others keep sharing them.
+	uint32 final = static_cast<uint32>(std::find(_finalStates->begin(), _finalStates->end(), state) - _finalStates->begin());
+
+	if (final < _finalStates->size())
+	{
+		StatesVector& finalStates = _finalStates.GetMutable();
+		finalStates.erase(finalStates.begin() + final);
+	}
+
+	// Remove all its references from the transition tables. The other states keep their indexes,
+	// so the rows go up to the highest one still referenced. The tables are only replaced when they change.
+	TransitionsVector transitions, lambdaTransitions;
+	uint32 rows = _states - 1;
+	bool const referenced = RemoveTransitions(*_transitionTable, state, &transitions, &rows);
+	bool const lambdaReferenced = RemoveTransitions(*_lambdaTable, state, &lambdaTransitions, &rows);
+
+	_states--;
+
+	if (referenced || lambdaReferenced || rows != _transitionTable->GetStates())
+		SetTransitions(std::move(transitions), std::move(lambdaTransitions));
+}
+
+void FiniteAutomata::RemoveUnreachableStates()
+{
+	if (!HasStates())
+		return;
+
+	RetainStates(GetReachableStates());
+}
+
+void FiniteAutomata::Trim()
+{
+	if (!HasStates())
+		return;
+
+	LFA_STATISTICS_OPERATION("Trim");
+
+	Vector<bool> const useful = GetUsefulStates();
+
+	if (!useful[_initialState])
+	{
+		_states = 1;
+		_initialState = 0;
+		_finalStates = StatesVector();
+		SetTransitions(TransitionsVector(), TransitionsVector());
+		OnChanged();
+		return;
+	}
+
+	RetainStates(useful);
+}
+
+void FiniteAutomata::RetainStates(Vector<bool> const& keep)
+{
+	StatesVector numbering(keep.size(), TransitionTable::InvalidState);
+	uint32 states = 0;
+
+	for (uint32 state = 0; state < keep.size(); ++state)
+		if (keep[state])
+			numbering[state] = states++;
+
+	RenumberStates(numbering);
+}
+
+void FiniteAutomata::RenumberStates(StatesVector const& numbering)
+{
+	if (!HasStates())
+		return;
+
+	assert(_initialState < numbering.size() && numbering[_initialState] != TransitionTable::InvalidState);
+
+	uint32 states = 0;
+	StatesVector finalStates;
+	TransitionsVector transitions, lambdaTransitions;
+
+	for (StatesConstIterator itr = numbering.begin(); itr != numbering.end(); ++itr)
+		if ((*itr) != TransitionTable::InvalidState)
+			states = std::max(states, (*itr) + 1);
+
+	RenumberTransitions(*_transitionTable, numbering, &transitions);
+	RenumberTransitions(*_lambdaTable, numbering, &lambdaTransitions);
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		if ((*itr) < numbering.size() && numbering[*itr] != TransitionTable::InvalidState)
+			finalStates.push_back(numbering[*itr]);
+
+	std::sort(finalStates.begin(), finalStates.end());
+
+	_states = states;
+	_initialState = numbering[_initialState];
+	_finalStates = std::move(finalStates);
+	SetTransitions(std::move(transitions), std::move(lambdaTransitions));
+
+	OnChanged();
+}
+
+void FiniteAutomata::Minimize()
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates())
+		return;
+
+	*this = GetMinimalDFA();
+}
+
+DFA FiniteAutomata::GetMinimalDFA() const
+{
+	// This methods is using Brzozowski's algorithm.
+	// Reverses a FA(either deterministic or nondeterministic)
+	// then converts it to a DFA and then reverses it again.
+	// It can be used for NFA even if it produces a DFA.
+	// NFAs are extensions of DFAs.
+	// Both determinizations run directly over a reversed transition table,
+	// so neither the reversed automata nor the intermediate DFA are built.
+	if (!HasStates())
+		return DFA();
+
+	if (!HasTransitions() || !HasFinalStates())
+		return DFA(1, 0, IsFinalState(_initialState) ? StatesVector({ 0 }) : StatesVector(), TransitionTable(1, TransitionsVector()));
+
+	LFA_STATISTICS_OPERATION("Minimize");
+
+	uint32 states;
+	StatesVector finalStates, startStates, subset, marks;
+	TransitionsVector transitions;
+	TransitionTable reversed = GetTransitionTable().GetReverse();
+	TransitionTable const reversedLambda = GetLambdaTable().GetReverse();
+
+	{
+		LFA_STATISTICS_PHASE("FirstDeterminization");
+		states = DeterminizeReverse(reversed, HasLambdaTransitions() ? &reversedLambda : nullptr, *_finalStates, _initialState,
+			&finalStates, &transitions, &subset, &marks);
+	}
+
+	// Reverse the intermediate DFA in place.
+	for (TransitionsVector::iterator itr = transitions.begin(); itr != transitions.end(); ++itr)
+		std::swap(itr->first.first, itr->second);
+
+	reversed = TransitionTable(states, std::move(transitions));
+	startStates.swap(finalStates);
+
+	{
+		LFA_STATISTICS_PHASE("SecondDeterminization");
+		states = DeterminizeReverse(reversed, nullptr, startStates, 0, &finalStates, &transitions, &subset, &marks);
+	}
+
+	return DFA(states, 0, std::move(finalStates), TransitionTable(states, std::move(transitions)));
+}
+
+DFA FiniteAutomata::GetReverseDFA() const
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates())
+		return DFA();
+
+	StatesVector finalStates, subset, marks;
+	TransitionsVector transitions;
+	TransitionTable const reversedLambda = GetLambdaTable().GetReverse();
+	uint32 states = DeterminizeReverse(GetTransitionTable().GetReverse(), HasLambdaTransitions() ? &reversedLambda : nullptr,
+		*_finalStates, _initialState, &finalStates, &transitions, &subset, &marks);
+
+	return DFA(states, 0, std::move(finalStates), TransitionTable(states, std::move(transitions)));
+}
+
+StatesSet FiniteAutomata::GetInconclusiveStates() const
+{
+	if (!HasStates())
+		return StatesSet();
+
+	StatesSet inconclusiveStates;
+
+	// We iterate through the rows of the transition table in case states we're removed from the automaton.
+	CopyOnWrite<TransitionTable> const graph = GetGraph();
+	TransitionTable const& table = *graph;
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		if (table.GetEdgesBegin(state) != table.GetEdgesEnd(state) && !IsFinalState(state))
+			inconclusiveStates.insert(state);
+
+	return inconclusiveStates;
+}
+
+StatesSet FiniteAutomata::GetFinalStates() const
+{
+	if (!HasFinalStates())
+		return StatesSet();
+
+	StatesSet finalStates;
+
+	for (StatesConstIterator itr = _finalStates->cbegin(); itr != _finalStates->cend(); ++itr)
+		finalStates.insert(*itr);
+
+	return finalStates;
+}
+
+Set<char> FiniteAutomata::GetAlphabet() const
+{
+	if (!HasStates() || !HasTransitions())
+		return Set<char>();
+
+	Set<char> alphabet;
+
+	for (uint32 edge = 0; edge < _transitionTable->GetEdgesCount(); ++edge)
+		alphabet.insert(_transitionTable->GetSymbol(edge));
+
+	return alphabet;
+}
+
+Vector<bool> FiniteAutomata::GetReachableStates() const
+{
+	if (!HasStates())
+		return Vector<bool>();
+
+	CopyOnWrite<TransitionTable> const graph = GetGraph();
+	TransitionTable const& table = *graph;
+	Stack<uint32> stack;
+	Vector<bool> visited(table.GetStates(), false);
+	
+	stack.push(_initialState);
+	visited[_initialState] = true;
+
+	while (!stack.empty())
+	{
+		uint32 currentState = stack.top();
+		stack.pop();
+
+		for (uint32 edge = table.GetEdgesBegin(currentState); edge < table.GetEdgesEnd(currentState); ++edge)
+		{
+			TargetsRange targets = table.GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				if (!visited[(*itr)])
+				{
+					stack.push((*itr));
+					visited[(*itr)] = true;
+				}
+		}
+	}
+
+	return visited;
+}
+
+Vector<bool> FiniteAutomata::GetUsefulStates() const
+{
+	if (!HasStates())
+		return Vector<bool>();
+
+	CopyOnWrite<TransitionTable> const graph = GetGraph();
+	TransitionTable const& table = *graph;
+	Vector<bool> finalStates(table.GetStates(), false);
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		if ((*itr) < finalStates.size())
+			finalStates[*itr] = true;
+
+	return table.GetUsefulStates(_initialState, finalStates);
+}
+
+FiniteAutomata::LanguageSize FiniteAutomata::GetLanguageSize() const
+{
+	if (!HasStates())
+		return LANGUAGE_EMPTY;
+
+	TransitionTable const& table = GetTransitionTable();
+	Vector<bool> useful;
+	StatesVector components;
+
+	if (!GetUsefulComponents(*GetGraph(), &useful, &components))
+		return LANGUAGE_EMPTY;
+
+	// Only the transitions reading a symbol are looked at, a cycle of lambda transitions reads nothing.
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		if (useful[state])
+			for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			{
+				TargetsRange targets = table.GetTargets(edge);
+
+				for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+					if (components[*itr] == components[state])
+						return LANGUAGE_INFINITE;
+			}
+
+	return LANGUAGE_FINITE;
+}
+
+uint32 FiniteAutomata::GetLongestWordLength() const
+{
+	if (GetLanguageSize() != LANGUAGE_FINITE)
+		return TransitionTable::InvalidState;
+
+	TransitionTable const& table = GetTransitionTable();
+	TransitionTable const& lambdaTable = GetLambdaTable();
+	Vector<bool> useful;
+	StatesVector components, order;
+	uint32 const count = GetUsefulComponents(*GetGraph(), &useful, &components);
+
+	// In a finite language the edges inside a component are lambda transitions, so the states
+	// of a component share their longest word and the components are handled sinks first.
+	// Every useful state reaches a final one, so 0 is a lower bound for each component.
+	StatesVector longest(count, 0);
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		if (useful[state])
+			order.push_back(state);
+
+	std::sort(order.begin(), order.end(), [&components](uint32 const& first, uint32 const& second)
+	{
+		return components[first] < components[second];
+	});
+
+	// A transition reading a symbol adds one to the length, a lambda transition nothing.
+	auto relax = [&](TransitionTable const& edges, uint32 const& state, uint32 const& length)
+	{
+		if (state >= edges.GetStates())
+			return;
+
+		for (uint32 edge = edges.GetEdgesBegin(state); edge < edges.GetEdgesEnd(state); ++edge)
+		{
+			TargetsRange targets = edges.GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				if (useful[*itr] && components[*itr] != components[state])
+					longest[components[state]] = std::max(longest[components[state]], longest[components[*itr]] + length);
+		}
+	};
+
+	for (StatesConstIterator itr = order.begin(); itr != order.end(); ++itr)
+	{
+		relax(table, *itr, 1);
+		relax(lambdaTable, *itr, 0);
+	}
+
+	return longest[components[_initialState]];
+}
+
+uint32 FiniteAutomata::GetUsefulComponents(TransitionTable const& table, Vector<bool>* useful, StatesVector* components) const
+{
+	Vector<bool> finalStates(table.GetStates(), false);
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		if ((*itr) < finalStates.size())
+			finalStates[*itr] = true;
+
+	*useful = table.GetUsefulStates(_initialState, finalStates);
+
+	if (!(*useful)[_initialState])
+		return 0;
+
+	return GetComponents(table, *useful, components);
+}
+
+StatesVector FiniteAutomata::GetBreadthFirstNumbering() const
+{
+	if (!HasStates())
+		return StatesVector();
+
+	CopyOnWrite<TransitionTable> const graph = GetGraph();
+	TransitionTable const& table = *graph;
+	StatesVector numbering(table.GetStates(), TransitionTable::InvalidState);
+	Queue<uint32> queue;
+	uint32 states = 0;
+
+	queue.push(_initialState);
+	numbering[_initialState] = states++;
+
+	while (!queue.empty())
+	{
+		uint32 currentState = queue.front();
+		queue.pop();
+
+		for (uint32 edge = table.GetEdgesBegin(currentState); edge < table.GetEdgesEnd(currentState); ++edge)
+		{
+			TargetsRange targets = table.GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				if (numbering[*itr] == TransitionTable::InvalidState)
+				{
+					numbering[*itr] = states++;
+					queue.push(*itr);
+				}
+		}
+	}
+
+	return numbering;
+}
+
+StatesVector FiniteAutomata::GetDepthFirstNumbering() const
+{
+	if (!HasStates())
+		return StatesVector();
+
+	CopyOnWrite<TransitionTable> const graph = GetGraph();
+	TransitionTable const& table = *graph;
+	StatesVector numbering(table.GetStates(), TransitionTable::InvalidState);
+	Stack<uint32> stack;
+	uint32 states = 0;
+
+	stack.push(_initialState);
+
+	while (!stack.empty())
+	{
+		uint32 currentState = stack.top();
+		stack.pop();
+
+		if (numbering[currentState] != TransitionTable::InvalidState)
+			continue;
+
+		numbering[currentState] = states++;
+
+		// Pushed backwards, so the first symbol is visited first.
+		for (uint32 edge = table.GetEdgesEnd(currentState); edge > table.GetEdgesBegin(currentState); --edge)
+		{
+			TargetsRange targets = table.GetTargets(edge - 1);
+
+			for (uint32 const* itr = targets.second; itr != targets.first; --itr)
+				if (numbering[*(itr - 1)] == TransitionTable::InvalidState)
+					stack.push(*(itr - 1));
+		}
+	}
+
+	return numbering;
+}
+
+StatesVector FiniteAutomata::GetProfileNumbering(VisitProfile const& profile) const
+{
+	if (!HasStates())
+		return StatesVector();
+
+	CopyOnWrite<TransitionTable> const graph = GetGraph();
+	TransitionTable const& table = *graph;
+	StatesVector const breadthFirst = GetBreadthFirstNumbering();
+	StatesVector order, numbering(table.GetStates(), TransitionTable::InvalidState);
+	uint32 states = 0;
+
+	auto visits = [&profile](uint32 const& state) { return state < profile.size() ? profile[state] : 0; };
+
+	for (uint32 state = 0; state < breadthFirst.size(); ++state)
+		if (breadthFirst[state] != TransitionTable::InvalidState)
+			order.push_back(state);
+
+	std::sort(order.begin(), order.end(), [&](uint32 const& first, uint32 const& second)
+	{
+		if (visits(first) != visits(second))
+			return visits(first) > visits(second);
+
+		return breadthFirst[first] < breadthFirst[second];
+	});
+
+	for (StatesConstIterator itr = order.begin(); itr != order.end(); ++itr)
+	{
+		uint32 state = *itr;
+
+		while (state != TransitionTable::InvalidState && numbering[state] == TransitionTable::InvalidState)
+		{
+			numbering[state] = states++;
+
+			uint32 next = TransitionTable::InvalidState;
+
+			for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			{
+				TargetsRange targets = table.GetTargets(edge);
+
+				for (uint32 const* iter = targets.first; iter != targets.second; ++iter)
+					if (numbering[*iter] == TransitionTable::InvalidState && visits(*iter) &&
+						(next == TransitionTable::InvalidState || visits(*iter) > visits(next)))
+						next = *iter;
+			}
+
+			state = next;
+		}
+	}
+
+	return numbering;
+}
+
+bool FiniteAutomata::IsFinalState(uint32 const& state) const
+{
+	if (!HasStates() || !HasFinalStates())
+		return false;
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		if ((*itr) == state)
+			return true;
+
+	return false;
+}
+
+bool FiniteAutomata::IsFinalState(StatesSet const& state) const
+{
+	if (!HasStates() || !HasFinalStates() || state.empty())
+		return false;
+
+	for (StatesSetConstIterator itr = state.begin(); itr != state.end(); ++itr)
+		if (IsFinalState(*itr))
+			return true;
+
+	return false;
+}
+
+uint64 FiniteAutomata::GetFingerprint() const
+{
+	// FNV-1a
+	uint64 hash = 14695981039346656037ULL;
+
+	if (!HasStates())
+		return hash;
+
+	TransitionTable const& table = GetTransitionTable();
+	TransitionTable const& lambdaTable = GetLambdaTable();
+	StatesVector const numbering = GetBreadthFirstNumbering();
+	StatesVector order(table.GetStates(), TransitionTable::InvalidState);
+	StatesVector targets;
+	uint32 states = 0;
+
+	for (uint32 i = 0; i < numbering.size(); ++i)
+		if (numbering[i] != TransitionTable::InvalidState)
+		{
+			order[numbering[i]] = i;
+			++states;
+		}
+
+	Vector<uint32> words(1, states);
+
+	auto addTargets = [&](TargetsRange const& range)
+	{
+		targets.clear();
+
+		for (uint32 const* itr = range.first; itr != range.second; ++itr)
+			targets.push_back(numbering[*itr]);
+
+		std::sort(targets.begin(), targets.end());
+
+		words.push_back(static_cast<uint32>(targets.size()));
+		words.insert(words.end(), targets.begin(), targets.end());
+	};
+
+	for (uint32 i = 0; i < states; ++i)
+	{
+		uint32 const state = order[i];
+
+		words.push_back(IsFinalState(state) ? 1 : 0);
+		words.push_back(table.GetEdgesEnd(state) - table.GetEdgesBegin(state));
+
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+		{
+			words.push_back(static_cast<uint8>(table.GetSymbol(edge)));
+			addTargets(table.GetTargets(edge));
+		}
+
+		addTargets(lambdaTable.Find(state, Lambda));
+	}
+
+	for (Vector<uint32>::const_iterator itr = words.begin(); itr != words.end(); ++itr)
+		for (uint32 i = 0; i < 4; ++i)
+		{
+			hash ^= ((*itr) >> (8 * i)) & 0xFF;
+			hash *= 1099511628211ULL;
+		}
+
+	return hash;
+}
+
+bool FiniteAutomata::Write(std::ofstream& ofs) const
+{
+	ofs << _states << " " << _initialState << " " << _finalStates->size() << "\n";
+
+	for (uint32 i = 0; i < _finalStates->size(); ++i)
+		ofs << (i ? " " : "") << (*_finalStates)[i];
+
+	ofs << "\n";
+
+	TransitionTable const* tables[] = { &*_transitionTable, &*_lambdaTable };
+
+	for (TransitionTable const* table : tables)
+		for (uint32 state = 0; state < table->GetStates(); ++state)
+			for (uint32 edge = table->GetEdgesBegin(state); edge < table->GetEdgesEnd(state); ++edge)
+			{
+				TargetsRange targets = table->GetTargets(edge);
+
+				for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+					ofs << state << " " << table->GetSymbol(edge) << " " << (*itr) << "\n";
+			}
+
+	return true;
+}
+
+NFA FiniteAutomata::GetReverse() const
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates())
+		return NFA();
+
+	uint32 initialState;
+	uint32 const states = (_finalStates->size() > 1) ? _states + 1 : _states;
+	StatesVector finalStates;
+	TransitionsVector transitions = _transitionTable->GetTransitions();
+	TransitionsVector lambdaTransitions = _lambdaTable->GetTransitions();
+
+	// Reverse transitions
+	for (TransitionsVector::iterator itr = transitions.begin(); itr != transitions.end(); ++itr)
+		std::swap(itr->first.first, itr->second);
+
+	for (TransitionsVector::iterator itr = lambdaTransitions.begin(); itr != lambdaTransitions.end(); ++itr)
+		std::swap(itr->first.first, itr->second);
+
+	// Build initial state
+	if (_finalStates->size() > 1)
+	{
+		initialState = _states;
+
+		for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+			lambdaTransitions.emplace_back(TransitionPair(_states, Lambda), *itr);
+	}
+	else
+		initialState = _finalStates->front();
+
+	// Build final state
+	finalStates.push_back(_initialState);
+
+	// Build the reversed nfa
+	return NFA(states, initialState, std::move(finalStates), std::move(transitions), std::move(lambdaTransitions));
+}
+
+FiniteAutomata& FiniteAutomata::operator=(FiniteAutomata const& source)
+{
+	if (this == &source)
+		return *this;
+
+	_states = source._states;
+	_finalStates = source._finalStates;
+	_initialState = source._initialState;
+	_transitionTable = source._transitionTable;
+	_lambdaTable = source._lambdaTable;
+
+	OnChanged();
+
+	return *this;
+}
+
+FiniteAutomata& FiniteAutomata::operator=(FiniteAutomata&& source)
+{
+	if (this == &source)
+		return *this;
+
+	_states = source._states;
+	_finalStates = std::move(source._finalStates);
+	_initialState = source._initialState;
+	_transitionTable = std::move(source._transitionTable);
+	_lambdaTable = std::move(source._lambdaTable);
+
+	source._states = 0;
+
+	OnChanged();
+
+	return *this;
+}
+
@@ -1,65 +1,164 @@
-#ifndef LFA_LIB_FINITE_AUTOMATA_H
-#define LFA_LIB_FINITE_AUTOMATA_H
-
-#include "PCH.h"
-
-typedef Set<uint32> StatesSet;
-typedef Vector<uint32> StatesVector;
-typedef Pair<uint32, char> TransitionPair;
-typedef Map<TransitionPair, StatesVector> TransitionMap;
-typedef StatesVector::const_iterator StatesConstIterator;
-typedef StatesSet::const_iterator StatesSetConstIterator;
-typedef TransitionMap::const_iterator TransitionMapConstIterator;
-
-class NondeterministicFiniteAutomata;
-
-class FiniteAutomata
-{
-	public:
-		virtual void Reverse() = 0;
-		void RemoveState(uint32 const& state);
-		void RemoveUnreachableStates();
-
-		bool HasStates() const { return (_states != 0) ? true : false; }
-		bool HasFinalStates() const { return !_finalStates.empty(); }
-		bool HasTransitions() const { return !_transitionFunction.empty(); }
-
-		virtual bool IsAccepted(String const& word) const = 0;
-
-		virtual String GenerateWord(uint32 const& length) const = 0;
-
-		virtual void Minimize();
-
-		StatesSet GetInconclusiveStates() const;
-		StatesSet GetFinalStates() const;
-
-		Set<char> GetAlphabet() const;
-
-		Vector<bool> GetReachableStates() const;
-
-		NondeterministicFiniteAutomata GetReverse() const;
-
-		FiniteAutomata& operator=(FiniteAutomata const& source);
-
-	protected:
-		uint32 _states;
-		uint32 _initialState;
-		StatesVector _finalStates;
-		TransitionMap _transitionFunction;
-
-		FiniteAutomata() { }
-		FiniteAutomata(FiniteAutomata const& source) : _states(source._states), _initialState(source._initialState),
-			_finalStates(source._finalStates), _transitionFunction(source._transitionFunction) { }
-		FiniteAutomata(uint32 const& states, uint32 const& initialState, 
-			StatesVector const& finalStates, TransitionMap const& transitionFunction) : 
-			_states(states), _initialState(initialState), _finalStates(finalStates), 
-			_transitionFunction(transitionFunction) { }
-
-		bool IsFinalState(uint32 const& state) const;
-		bool IsFinalState(StatesSet const& state) const;
-};
-
-typedef FiniteAutomata FA;
-
-#endif
-
+#ifndef LFA_LIB_FINITE_AUTOMATA_H
+#define LFA_LIB_FINITE_AUTOMATA_H
+
+#include "PCH.h"
+#include "CopyOnWrite.h"
+#include "TransitionTable.h"
+
+typedef Vector<uint64> VisitProfile;	// Visits of every state while matching sample words.
+
+class DeterministicFiniteAutomata;
+class NondeterministicFiniteAutomata;
+
+class FiniteAutomata
+{
+	public:
+		enum LanguageSize
+		{
+			LANGUAGE_EMPTY,
+			LANGUAGE_FINITE,
+			LANGUAGE_INFINITE
+		};
+
+		static char const Lambda;	// Symbol of the edges of the lambda table, '0' in the NFA input files.
+
+		virtual void Reverse() = 0;
+		void RemoveState(uint32 const& state);
+		void RemoveUnreachableStates();	// The remaining states are renumbered in the same order.
+
+		// Removes the unreachable states and the states no final state is reachable from, in linear time.
+		// The remaining states are renumbered in the same order. Without accepted words only a non final initial state is left.
+		void Trim();
+
+		// numbering[state] is the new index of state. States numbered TransitionTable::InvalidState are removed.
+		void RenumberStates(StatesVector const& numbering);
+
+		uint32 GetStatesCount() const { return _states; }
+		uint32 GetInitialState() const { return _initialState; }
+
+		bool HasStates() const { return (_states != 0) ? true : false; }
+		bool HasFinalStates() const { return !_finalStates->empty(); }
+		bool HasTransitions() const { return _transitionTable->GetEdgesCount() != 0 || HasLambdaTransitions(); }
+		bool HasLambdaTransitions() const { return _lambdaTable->GetEdgesCount() != 0; }
+
+		virtual bool IsAccepted(String const& word) const = 0;
+
+		virtual String GenerateWord(uint32 const& length) const = 0;
+
+		virtual void Minimize();
+
+		// The minimal DFA of the automaton, built with Brzozowski's algorithm.
+		DeterministicFiniteAutomata GetMinimalDFA() const;
+
+		StatesSet GetInconclusiveStates() const;
+		StatesSet GetFinalStates() const;
+
+		Set<char> GetAlphabet() const;
+
+		Vector<bool> GetReachableStates() const;
+		Vector<bool> GetUsefulStates() const;	// Reachable states a final state is reachable from.
+
+		// Answered from the strongly connected components of the useful states, without generating words.
+		// A cycle of lambda transitions reads nothing, so only a cycle reading a symbol makes the language infinite.
+		LanguageSize GetLanguageSize() const;
+		bool IsEmpty() const { return GetLanguageSize() == LANGUAGE_EMPTY; }
+		bool IsFinite() const { return GetLanguageSize() != LANGUAGE_INFINITE; }
+
+		// Length of the longest accepted word, TransitionTable::InvalidState if the language is empty or infinite.
+		uint32 GetLongestWordLength() const;
+
+		// The transitions are stored in this table, the TransitionMap constructors convert at the boundary.
+		TransitionTable const& GetTransitionTable() const { return *_transitionTable; }
+
+		// The lambda transitions are kept apart from the symbols, every edge of this table is on Lambda.
+		// Only NFAs have them, so every symbol, Lambda included, stands for itself in GetTransitionTable.
+		TransitionTable const& GetLambdaTable() const { return *_lambdaTable; }
+
+		// Numbers the reachable states in breadth-first order from the initial state,
+		// visiting transitions in symbol order. Unreachable states get TransitionTable::InvalidState.
+		StatesVector GetBreadthFirstNumbering() const;
+
+		// Same as GetBreadthFirstNumbering, in depth-first preorder, so a path of first edges is contiguous.
+		StatesVector GetDepthFirstNumbering() const;
+
+		// Numbers the most visited states first. Each one is followed by the chain of its most visited
+		// successors not numbered yet, so a hot path shares cache lines. Unvisited reachable states come last,
+		// in breadth-first order. The profile comes from DFA::IsAccepted(word, profile) over sample words.
+		StatesVector GetProfileNumbering(VisitProfile const& profile) const;
+
+		NondeterministicFiniteAutomata GetReverse() const;
+
+		// The DFA of the reversed language, determinized directly over the reversed transition table.
+		DeterministicFiniteAutomata GetReverseDFA() const;
+
+		// Hash of the reachable part of the automaton under GetBreadthFirstNumbering,
+		// so it does not change when the states are renumbered.
+		// For NFAs the targets of a transition are visited in index order, so only DFAs are fully invariant.
+		// The lambda transitions of a state are hashed after its edges.
+		uint64 GetFingerprint() const;
+
+		// Writes the automaton in the input file format, the lambda transitions on Lambda.
+		// Returns false and writes nothing if the file could not be read back, see NFA::Write.
+		virtual bool Write(std::ofstream& ofs) const;
+
+		FiniteAutomata& operator=(FiniteAutomata const& source);
+		FiniteAutomata& operator=(FiniteAutomata&& source);
+
+	protected:
+		uint32 _states;
+		uint32 _initialState;
+		CopyOnWrite<StatesVector> _finalStates;			// Shared between copies until changed.
+		CopyOnWrite<TransitionTable> _transitionTable;	// Has a row for every state, replaced as a whole when changed.
+		CopyOnWrite<TransitionTable> _lambdaTable;		// Empty, or with the rows of _transitionTable.
+
+		FiniteAutomata() : _states(0), _initialState(0) { }
+		FiniteAutomata(FiniteAutomata const& source) : _states(source._states), _initialState(source._initialState),
+			_finalStates(source._finalStates), _transitionTable(source._transitionTable), _lambdaTable(source._lambdaTable) { }
+		FiniteAutomata(FiniteAutomata&& source) : _states(source._states), _initialState(source._initialState),
+			_finalStates(std::move(source._finalStates)), _transitionTable(std::move(source._transitionTable)),
+			_lambdaTable(std::move(source._lambdaTable)) { source._states = 0; }
+		FiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector const& finalStates, TransitionMap const& transitionFunction) : 
+			_states(states), _initialState(initialState), _finalStates(finalStates), 
+			_transitionTable(TransitionTable(states, transitionFunction)) { }
+		FiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector const& finalStates, TransitionTable const& transitionTable) : 
+			_states(states), _initialState(initialState), _finalStates(finalStates), 
+			_transitionTable(transitionTable) { assert(GetTransitionTable().GetStates() >= states); }
+		FiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector&& finalStates, TransitionTable&& transitionTable) : 
+			_states(states), _initialState(initialState), _finalStates(std::move(finalStates)), 
+			_transitionTable(std::move(transitionTable)) { assert(GetTransitionTable().GetStates() >= states); }
+		FiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector const& finalStates, TransitionTable const& transitionTable, TransitionTable const& lambdaTable);
+		FiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			StatesVector&& finalStates, TransitionsVector transitions, TransitionsVector lambdaTransitions) : 
+			_states(states), _initialState(initialState), _finalStates(std::move(finalStates))
+		{
+			SetTransitions(std::move(transitions), std::move(lambdaTransitions));
+		}
+
+		// Replaces both tables, the symbols of lambdaTransitions are ignored.
+		void SetTransitions(TransitionsVector transitions, TransitionsVector lambdaTransitions);
+
+		bool IsFinalState(uint32 const& state) const;
+		bool IsFinalState(StatesSet const& state) const;
+
+		// Called after the automaton changed, so what a derived class built from it can be dropped.
+		virtual void OnChanged() { }
+
+	private:
+		void RetainStates(Vector<bool> const& keep);
+
+		// The transitions with the lambda transitions on Lambda, for the algorithms which only follow edges.
+		// Shares _transitionTable when there are no lambda transitions.
+		CopyOnWrite<TransitionTable> GetGraph() const;
+
+		// Strongly connected components of the useful states, see GetComponents in FiniteAutomata.cpp.
+		uint32 GetUsefulComponents(TransitionTable const& table, Vector<bool>* useful, StatesVector* components) const;
+};
+
+typedef FiniteAutomata FA;
+
+#endif
+
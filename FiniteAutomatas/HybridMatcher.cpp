@@ -0,0 +1,281 @@
+#include "PCH.h"
+#include "HybridMatcher.h"
+#include "Statistics.h"
+
+uint32 const HybridMatcher::ThrashingBytesPerState;
+uint32 const HybridMatcher::UnknownState = TransitionTable::InvalidState - 1;
+uint64 const HybridMatcher::MapNodeMemoryUsage = 4 * sizeof(void*);
+
+HybridMatcher::HybridMatcher(NFA const& nfa, uint64 const& memoryBudget) : _initialState(0), _mode(MODE_NFA),
+	_memoryBudget(memoryBudget), _fixedMemoryUsage(0), _cacheMemoryUsage(0), _maximumStates(0), _cacheFlushes(0),
+	_bytesSinceFlush(0), _stamp(0)
+{
+	if (!nfa.HasStates())
+		return;
+
+	LFA_STATISTICS_OPERATION("HybridMatcher");
+
+	_table = nfa.GetTransitionTable();
+	_lambdaTable = nfa.GetLambdaTable();
+	_initialState = nfa.GetInitialState();
+	_finalStates.assign(_table.GetStates(), false);
+
+	StatesSet const finalStates = nfa.GetFinalStates();
+
+	for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		if ((*itr) < _table.GetStates())
+			_finalStates[*itr] = true;
+
+	for (uint32 edge = 0; edge < _table.GetEdgesCount(); ++edge)
+		_alphabet.insert(_table.GetSymbol(edge));
+
+	// The NFA tables, the final flags, the marks and two subsets of at most every state.
+	_fixedMemoryUsage = _table.GetMemoryUsage() + _lambdaTable.GetMemoryUsage() + _table.GetStates() / 8 + 3 * sizeof(uint32) * _table.GetStates();
+	_marks.assign(_table.GetStates(), TransitionTable::InvalidState);
+	_current.reserve(_table.GetStates());
+	_subset.reserve(_table.GetStates());
+
+	// The per state containers are reserved once, so they never grow past the budget.
+	uint64 const perState = sizeof(StatesVector) + sizeof(StatesVector const*) + 1;
+	uint64 const minimumStateMemoryUsage = perState + 256 * sizeof(uint32) + sizeof(StatesVector) + MapNodeMemoryUsage;
+
+	if (_memoryBudget > _fixedMemoryUsage)
+		_maximumStates = static_cast<uint32>(std::min<uint64>((_memoryBudget - _fixedMemoryUsage) / minimumStateMemoryUsage,
+			TransitionTable::InvalidState - 1));
+
+	_fixedMemoryUsage += perState * _maximumStates;
+	_next.reserve(_maximumStates);
+	_subsets.reserve(_maximumStates);
+	_acceptingStates.reserve(_maximumStates);
+
+	_initialSubset.assign(1, _initialState);
+	uint32 const stamp = GetStamp();
+	_marks[_initialState] = stamp;
+	_lambdaTable.AddClosure(FiniteAutomata::Lambda, &_initialSubset, &_marks, stamp);
+
+	{
+		LFA_STATISTICS_PHASE("Determinize");
+
+		if (Determinize())
+		{
+			_mode = MODE_DFA;
+			return;
+		}
+	}
+
+	ClearCache();
+
+	if (CanAddState(_initialSubset))
+	{
+		_mode = MODE_LAZY_DFA;
+		AddState(_initialSubset);
+	}
+}
+
+bool HybridMatcher::IsAccepted(String const& word)
+{
+	if (_initialSubset.empty())
+		return false;
+
+	if (_mode != MODE_NFA)
+		return IsAcceptedLazy(word);
+
+	_current = _initialSubset;
+
+	return IsAcceptedNFA(word, 0);
+}
+
+uint64 HybridMatcher::GetStateMemoryUsage(StatesVector const& subset) const
+{
+	// The transitions row, the subset kept as a key of the index and the index node.
+	return 256 * sizeof(uint32) + sizeof(StatesVector) + sizeof(uint32) * subset.size() + MapNodeMemoryUsage;
+}
+
+bool HybridMatcher::CanAddState(StatesVector const& subset) const
+{
+	return GetCachedStatesCount() < _maximumStates && GetMemoryUsage() + GetStateMemoryUsage(subset) <= _memoryBudget;
+}
+
+uint32 HybridMatcher::AddState(StatesVector const& subset)
+{
+	LFA_STATISTICS_ADD(subsetsExplored, 1);
+	LFA_STATISTICS_ADD(subsetsStates, subset.size());
+
+	uint32 const state = GetCachedStatesCount();
+	bool accepting = false;
+
+	_subsets.push_back(&_subsetsIndex.emplace(subset, state).first->first);
+	_cacheMemoryUsage += GetStateMemoryUsage(subset);
+
+	for (StatesConstIterator itr = subset.begin(); itr != subset.end() && !accepting; ++itr)
+		accepting = _finalStates[*itr];
+
+	_acceptingStates.push_back(accepting);
+
+	// Symbols outside the alphabet lead nowhere.
+	_next.emplace_back(256, TransitionTable::InvalidState);
+
+	for (Set<char>::const_iterator key = _alphabet.begin(); key != _alphabet.end(); ++key)
+		_next.back()[static_cast<uint8>(*key)] = UnknownState;
+
+	return state;
+}
+
+void HybridMatcher::ClearCache()
+{
+	_subsetsIndex.clear();
+	_subsets.clear();
+	_acceptingStates.clear();
+	_next.clear();
+	_cacheMemoryUsage = 0;
+	_bytesSinceFlush = 0;
+}
+
+uint32 HybridMatcher::GetStamp()
+{
+	// Every symbol read takes a stamp, so they wrap around on long inputs.
+	if (++_stamp == TransitionTable::InvalidState)
+	{
+		std::fill(_marks.begin(), _marks.end(), TransitionTable::InvalidState);
+		_stamp = 0;
+	}
+
+	return _stamp;
+}
+
+void HybridMatcher::MoveTo(StatesVector const& subset, char const& key)
+{
+	uint32 const stamp = GetStamp();
+	_subset.clear();
+	_table.AddTargets(subset, key, &_subset, &_marks, stamp);
+
+	if (!_subset.empty())
+		_lambdaTable.AddClosure(FiniteAutomata::Lambda, &_subset, &_marks, stamp);
+}
+
+bool HybridMatcher::Determinize()
+{
+	if (!CanAddState(_initialSubset))
+		return false;
+
+	AddState(_initialSubset);
+
+	for (uint32 state = 0; state < GetCachedStatesCount(); ++state)
+		for (Set<char>::const_iterator key = _alphabet.begin(); key != _alphabet.end(); ++key)
+		{
+			MoveTo(*_subsets[state], *key);
+
+			uint32 next = TransitionTable::InvalidState;
+
+			if (!_subset.empty())
+			{
+				Map<StatesVector, uint32>::const_iterator itr = _subsetsIndex.find(_subset);
+
+				if (itr != _subsetsIndex.end())
+					next = itr->second;
+				else if (CanAddState(_subset))
+					next = AddState(_subset);
+				else
+					return false;
+			}
+
+			_next[state][static_cast<uint8>(*key)] = next;
+		}
+
+	// Every transition is built, the subsets are not needed anymore.
+	for (uint32 state = 0; state < GetCachedStatesCount(); ++state)
+		_cacheMemoryUsage -= GetStateMemoryUsage(*_subsets[state]) - 256 * sizeof(uint32);
+
+	_subsets.clear();
+	_subsetsIndex.clear();
+
+	return true;
+}
+
+bool HybridMatcher::IsAcceptedLazy(String const& word)
+{
+	uint32 state = 0;	// The initial subset is always the first state of the cache.
+
+	for (uint32 i = 0; i < word.size(); ++i, ++_bytesSinceFlush)
+	{
+		uint32 next = _next[state][static_cast<uint8>(word[i])];
+
+		if (next == UnknownState)
+		{
+			MoveTo(*_subsets[state], word[i]);
+			next = TransitionTable::InvalidState;
+
+			if (!_subset.empty())
+			{
+				Map<StatesVector, uint32>::const_iterator itr = _subsetsIndex.find(_subset);
+
+				if (itr != _subsetsIndex.end())
+					next = itr->second;
+				else if (CanAddState(_subset))
+					next = AddState(_subset);
+				else
+				{
+					// The cache is full. Unless it was flushed too recently, it is flushed and
+					// rebuilt from the initial subset and the subset just reached.
+					bool thrashing = _bytesSinceFlush < static_cast<uint64>(ThrashingBytesPerState) * GetCachedStatesCount();
+
+					_current.swap(_subset);
+					ClearCache();
+					++_cacheFlushes;
+
+					if (!thrashing && CanAddState(_initialSubset))
+					{
+						AddState(_initialSubset);
+
+						if (_current == _initialSubset)
+						{
+							state = 0;
+							continue;
+						}
+
+						if (CanAddState(_current))
+						{
+							state = AddState(_current);
+							continue;
+						}
+
+						ClearCache();
+					}
+
+					_mode = MODE_NFA;
+
+					return IsAcceptedNFA(word, i + 1);
+				}
+			}
+
+			_next[state][static_cast<uint8>(word[i])] = next;
+		}
+
+		if (next == TransitionTable::InvalidState)
+			return false;
+
+		state = next;
+	}
+
+	return _acceptingStates[state];
+}
+
+bool HybridMatcher::IsAcceptedNFA(String const& word, uint32 position)
+{
+	for (; position < word.size(); ++position)
+	{
+		MoveTo(_current, word[position]);
+
+		if (_subset.empty())
+			return false;
+
+		_current.swap(_subset);
+	}
+
+	for (StatesConstIterator itr = _current.begin(); itr != _current.end(); ++itr)
+		if (_finalStates[*itr])
+			return true;
+
+	return false;
+}
+
@@ -0,0 +1,80 @@
+#ifndef LFA_LIB_HYBRID_MATCHER_H
+#define LFA_LIB_HYBRID_MATCHER_H
+
+#include "PCH.h"
+#include "NondeterministicFiniteAutomata.h"
+#include "TransitionTable.h"
+
+// Matches words against an NFA within a memory budget, in bytes.
+// The NFA is first determinized in full. If the DFA does not fit, its states are built lazily
+// while matching and kept in a cache which is flushed once full. If the cache is flushed
+// before enough input went through it, the matcher simulates the NFA directly from then on.
+// The NFA table and the simulation buffers are always kept, the caches only use what is left.
+class HybridMatcher
+{
+	public:
+		enum Mode
+		{
+			MODE_DFA,		// Every DFA state is built.
+			MODE_LAZY_DFA,
+			MODE_NFA
+		};
+
+		// Flushing the cache after less than this many bytes per cached state counts as thrashing.
+		static uint32 const ThrashingBytesPerState = 10;
+
+		HybridMatcher(NFA const& nfa, uint64 const& memoryBudget);
+
+		Mode GetMode() const { return _mode; }
+
+		uint64 GetMemoryBudget() const { return _memoryBudget; }
+		uint64 GetMemoryUsage() const { return _fixedMemoryUsage + _cacheMemoryUsage; }
+
+		uint32 GetCachedStatesCount() const { return static_cast<uint32>(_acceptingStates.size()); }
+		uint32 GetCacheFlushes() const { return _cacheFlushes; }
+
+		bool IsAccepted(String const& word);
+
+	private:
+		static uint32 const UnknownState;	// Transition not built yet.
+		static uint64 const MapNodeMemoryUsage;
+
+		// NFA
+		TransitionTable _table;
+		TransitionTable _lambdaTable;
+		uint32 _initialState;
+		Vector<bool> _finalStates;
+		Set<char> _alphabet;
+
+		Mode _mode;
+		uint64 _memoryBudget;
+		uint64 _fixedMemoryUsage;
+		uint64 _cacheMemoryUsage;
+
+		// DFA states built so far, the subsets are dropped once the whole DFA is built.
+		Map<StatesVector, uint32> _subsetsIndex;
+		Vector<StatesVector const*> _subsets;
+		Vector<bool> _acceptingStates;
+		Vector<StatesVector> _next;		// 256 transitions per state.
+		uint32 _maximumStates;			// The containers above are reserved for this many states.
+		uint32 _cacheFlushes;
+		uint64 _bytesSinceFlush;
+
+		StatesVector _initialSubset, _subset, _current, _marks;
+		uint32 _stamp;
+
+		uint64 GetStateMemoryUsage(StatesVector const& subset) const;
+		bool CanAddState(StatesVector const& subset) const;
+		uint32 AddState(StatesVector const& subset);
+		void ClearCache();
+
+		uint32 GetStamp();	// A stamp no state is marked with.
+		void MoveTo(StatesVector const& subset, char const& key);	// Closed result in _subset.
+
+		bool Determinize();
+		bool IsAcceptedLazy(String const& word);
+		bool IsAcceptedNFA(String const& word, uint32 position);	// Starts in _current.
+};
+
+#endif
+
@@ -0,0 +1,121 @@
+#include "PCH.h"
+#include "IncrementalMatcher.h"
+#include "TransitionTable.h"
+#include "Statistics.h"
+
+namespace
+{
+	DFA GetTrimmedDFA(DFA const& dfa)
+	{
+		DFA trimmed(dfa);
+		trimmed.Trim();
+		return trimmed;
+	}
+
+	bool IsBefore(MatcherCheckpoint const& checkpoint, uint64 const& position)
+	{
+		return checkpoint.position < position;
+	}
+
+	bool IsAfter(uint64 const& position, MatcherCheckpoint const& checkpoint)
+	{
+		return position < checkpoint.position;
+	}
+}
+
+uint32 const IncrementalMatcher::DefaultInterval;
+
+IncrementalMatcher::IncrementalMatcher(DFA const& dfa, String const& buffer, uint32 const& interval) : 
+	_table(GetTrimmedDFA(dfa)), _interval(std::max(interval, 1u)), _state(TransitionTable::InvalidState), _matchedSymbols(0)
+{
+	Assign(buffer);
+}
+
+void IncrementalMatcher::Assign(String const& buffer)
+{
+	_buffer = buffer;
+	_checkpoints.assign(1, MatcherCheckpoint(0, _table.GetInitialState()));
+	_state = _table.GetInitialState();
+	_matchedSymbols = 0;
+
+	Replace(0, 0, String());
+}
+
+void IncrementalMatcher::Replace(uint64 const& position, uint64 const& length, String const& text)
+{
+	assert(position <= _buffer.size() && length <= _buffer.size() - position);
+
+	LFA_STATISTICS_OPERATION("IncrementalMatcher::Replace");
+
+	_buffer.replace(position, length, text);
+
+	int64 const shift = static_cast<int64>(text.size()) - static_cast<int64>(length);
+
+	// The last checkpoint at or before position only depends on the unchanged symbols before it.
+	// The ones after the removed symbols are the states of the old buffer to compare against, the ones in between are lost.
+	// Assign calls it with an empty checkpoint list past the first one, so the whole buffer is matched.
+	uint32 const restart = static_cast<uint32>(std::upper_bound(_checkpoints.begin() + 1, _checkpoints.end(), position, IsAfter) -
+		_checkpoints.begin() - 1);
+	uint32 old = static_cast<uint32>(std::lower_bound(_checkpoints.begin() + restart + 1, _checkpoints.end(), position + length, IsBefore) -
+		_checkpoints.begin());
+
+	MatcherCheckpointsVector checkpoints;
+	uint64 current = _checkpoints[restart].position, last = current;
+	uint32 state = _checkpoints[restart].state;
+	bool converged = false;
+
+	_matchedSymbols = 0;
+
+	while (true)
+	{
+		if (old < _checkpoints.size() && _checkpoints[old].position + shift == current)
+		{
+			// After an erase the old checkpoint can fall on the restart one, which is kept instead.
+			bool const restarted = current == _checkpoints[restart].position;
+
+			if (_checkpoints[old].state == state)
+			{
+				if (restarted)
+					++old;
+
+				converged = true;
+				break;
+			}
+
+			// Keeps the spacing of the old checkpoints.
+			if (!restarted)
+				checkpoints.emplace_back(current, state);
+
+			last = current;
+			++old;
+		}
+		else if (current - last == _interval)
+		{
+			checkpoints.emplace_back(current, state);
+			last = current;
+		}
+
+		// Every symbol after the dead state leads to it again.
+		if (current == _buffer.size() || (state == TransitionTable::InvalidState && old == _checkpoints.size()))
+			break;
+
+		state = _table.GetNextState(state, static_cast<uint8>(_buffer[current++]));
+		++_matchedSymbols;
+	}
+
+	LFA_STATISTICS_ADD(transitionLookups, _matchedSymbols);
+
+	if (!converged)
+	{
+		_state = state;
+		old = static_cast<uint32>(_checkpoints.size());
+	}
+
+	MatcherCheckpointsVector::iterator tail = _checkpoints.erase(_checkpoints.begin() + restart + 1, _checkpoints.begin() + old);
+
+	for (MatcherCheckpointsVector::iterator itr = tail; itr != _checkpoints.end(); ++itr)
+		itr->position += shift;
+
+	_checkpoints.insert(tail, checkpoints.begin(), checkpoints.end());
+}
+
@@ -0,0 +1,52 @@
+#ifndef LFA_LIB_INCREMENTAL_MATCHER_H
+#define LFA_LIB_INCREMENTAL_MATCHER_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+#include "CompressedTable.h"
+
+struct MatcherCheckpoint
+{
+	uint64 position;
+	uint32 state;	// State reached on the first position symbols of the buffer.
+
+	MatcherCheckpoint(uint64 const& position, uint32 const& state) : position(position), state(state) { }
+};
+
+typedef Vector<MatcherCheckpoint> MatcherCheckpointsVector;
+
+// Tells whether a DFA accepts a buffer which is edited in place, without matching the whole buffer after every edit.
+// The state reached every interval symbols is kept as a checkpoint. An edit is matched again from the last
+// checkpoint before it and, past the edited text, the states are compared with the checkpoints of the old buffer:
+// once one is the same, the rest of the buffer reaches the same states as before, so the remaining checkpoints
+// are only shifted. The symbols matched are bounded by the distance from the edit to the first unchanged checkpoint.
+class IncrementalMatcher
+{
+	public:
+		static uint32 const DefaultInterval = 256;
+
+		IncrementalMatcher(DFA const& dfa, String const& buffer = String(), uint32 const& interval = DefaultInterval);
+
+		// Replaces the length symbols at position with text.
+		void Replace(uint64 const& position, uint64 const& length, String const& text);
+		void Insert(uint64 const& position, String const& text) { Replace(position, 0, text); }
+		void Erase(uint64 const& position, uint64 const& length) { Replace(position, length, String()); }
+		void Assign(String const& buffer);
+
+		String const& GetBuffer() const { return _buffer; }
+		MatcherCheckpointsVector const& GetCheckpoints() const { return _checkpoints; }
+		uint64 GetMatchedSymbols() const { return _matchedSymbols; }	// By the last edit.
+
+		bool IsAccepted() const { return _table.IsFinalState(_state); }
+
+	private:
+		CompressedTable _table;		// Of the trimmed DFA, so a word without accepted extensions reaches the dead state.
+		uint32 _interval;
+		String _buffer;
+		MatcherCheckpointsVector _checkpoints;	// Sorted by position, the first one is the initial state at 0.
+		uint32 _state;	// Reached on the whole buffer.
+		uint64 _matchedSymbols;
+};
+
+#endif
+
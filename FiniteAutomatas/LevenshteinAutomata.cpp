@@ -0,0 +1,271 @@
+#include "PCH.h"
+#include "LevenshteinAutomata.h"
+#include "Statistics.h"
+
+LevenshteinAutomata::LevenshteinAutomata(String const& word, uint32 const& distance) : _word(word), _distance(distance)
+{
+	if (_word.size() > MaximumBitParallelLength)
+		return;
+
+	for (uint32 i = 0; i < _word.size(); ++i)
+		_masks[_word[i]] |= uint64(1) << (i + 1);
+}
+
+NFA LevenshteinAutomata::GetNFA(Set<char> const& alphabet) const
+{
+	uint32 const length = static_cast<uint32>(_word.size());
+	uint32 const columns = length + 1;
+	Set<char> symbols(alphabet);
+	Map<TransitionPair, StatesSet> transitions;
+	StatesVector finalStates;
+
+	symbols.insert(_word.begin(), _word.end());
+
+	// State (i, e) is errors e spent on the prefix of length i. Moving to (j, f) may be followed
+	// by deleting the next symbols of word, so (j + d, f + d) is a target too.
+	auto addTransition = [&](uint32 const& i, uint32 const& e, char const& key, uint32 j, uint32 f)
+	{
+		for (; j <= length && f <= _distance; ++j, ++f)
+			transitions[TransitionPair(e * columns + i, key)].insert(f * columns + j);
+	};
+
+	for (uint32 e = 0; e <= _distance; ++e)
+		for (uint32 i = 0; i <= length; ++i)
+		{
+			if (length - i <= _distance - e)
+				finalStates.push_back(e * columns + i);
+
+			if (i < length)
+				addTransition(i, e, _word[i], i + 1, e);
+
+			if (e == _distance)
+				continue;
+
+			for (Set<char>::const_iterator key = symbols.begin(); key != symbols.end(); ++key)
+			{
+				addTransition(i, e, *key, i, e + 1);		// Insertion
+
+				if (i < length)
+					addTransition(i, e, *key, i + 1, e + 1);	// Substitution
+			}
+		}
+
+	// The initial state may delete a prefix of word before reading anything, those states start in (0, 0)
+	// with a transition copied from each of them. The table merges the targets they share.
+	uint32 const states = columns * (_distance + 1);
+	TransitionsVector nfaTransitions;
+
+	for (Map<TransitionPair, StatesSet>::const_iterator itr = transitions.begin(); itr != transitions.end(); ++itr)
+		for (StatesSetConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
+			nfaTransitions.emplace_back(itr->first, *iter);
+
+	for (uint32 d = 1; d <= std::min<uint32>(length, _distance); ++d)
+		for (Set<char>::const_iterator key = symbols.begin(); key != symbols.end(); ++key)
+		{
+			Map<TransitionPair, StatesSet>::const_iterator itr = transitions.find(TransitionPair(d * columns + d, *key));
+
+			if (itr == transitions.end())
+				continue;
+
+			for (StatesSetConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
+				nfaTransitions.emplace_back(TransitionPair(0, *key), *iter);
+		}
+
+	return NFA(states, 0, std::move(finalStates), TransitionTable(states, std::move(nfaTransitions)));
+}
+
+DFA LevenshteinAutomata::GetDFA(Set<char> const& alphabet) const
+{
+	return GetNFA(alphabet).GetMinimalDFA();
+}
+
+bool LevenshteinAutomata::IsAccepted(String const& word) const
+{
+	LFA_STATISTICS_OPERATION("LevenshteinAutomata::IsAccepted");
+
+	// The lengths alone are too far apart.
+	if (std::max(word.size(), _word.size()) - std::min(word.size(), _word.size()) > _distance)
+		return false;
+
+	if (_word.size() <= MaximumBitParallelLength)
+		return IsAcceptedBitParallel(word);
+
+	DistanceRow row, next;
+	GetInitialRow(&row);
+
+	for (String::const_iterator itr = word.begin(); itr != word.end() && CanMatch(row); ++itr)
+	{
+		Step(row, *itr, &next);
+		row.swap(next);
+	}
+
+	return IsFinal(row);
+}
+
+bool LevenshteinAutomata::IsAcceptedBitParallel(String const& word) const
+{
+	// Bit i of states[e] tells that the prefix of length i is matched with at most e errors.
+	uint32 const length = static_cast<uint32>(_word.size());
+	uint64 const all = (length == 63) ? ~uint64(0) : (uint64(1) << (length + 1)) - 1;
+	Vector<uint64> states(_distance + 1), previous(_distance + 1);
+
+	// Deleting the first e symbols of word.
+	for (uint32 e = 0; e <= _distance; ++e)
+		states[e] = (e >= length) ? all : (uint64(1) << (e + 1)) - 1;
+
+	for (String::const_iterator itr = word.begin(); itr != word.end(); ++itr)
+	{
+		Map<char, uint64>::const_iterator mask = _masks.find(*itr);
+		uint64 const matches = (mask != _masks.end()) ? mask->second : 0;
+
+		previous.swap(states);
+		states[0] = (previous[0] << 1) & matches;
+
+		// Match, insertion of the symbol, substitution, then deletion from the new states.
+		for (uint32 e = 1; e <= _distance; ++e)
+			states[e] = (((previous[e] << 1) & matches) | previous[e - 1] | (previous[e - 1] << 1) | (states[e - 1] << 1)) & all;
+
+		if (!states[_distance])
+			return false;
+	}
+
+	return ((states[_distance] >> length) & 1) != 0;
+}
+
+void LevenshteinAutomata::GetInitialRow(DistanceRow* row) const
+{
+	row->resize(_word.size() + 1);
+
+	for (uint32 i = 0; i < row->size(); ++i)
+		(*row)[i] = std::min(i, _distance + 1);
+}
+
+void LevenshteinAutomata::Step(DistanceRow const& row, char const& key, DistanceRow* next) const
+{
+	uint32 const cap = _distance + 1;
+	next->resize(row.size());
+	(*next)[0] = std::min(row[0] + 1, cap);
+
+	for (uint32 i = 1; i < row.size(); ++i)
+	{
+		uint32 cost = row[i - 1] + ((_word[i - 1] == key) ? 0 : 1);
+		cost = std::min(cost, row[i] + 1);
+		cost = std::min(cost, (*next)[i - 1] + 1);
+		(*next)[i] = std::min(cost, cap);
+	}
+}
+
+bool LevenshteinAutomata::GetMatchingSymbols(DistanceRow const& row, String* symbols) const
+{
+	symbols->clear();
+
+	for (uint32 i = 0; i < row.size(); ++i)
+		if (row[i] < _distance)
+			return false;
+
+	for (uint32 i = 0; i + 1 < row.size(); ++i)
+		if (row[i] == _distance)
+			symbols->push_back(_word[i]);
+
+	std::sort(symbols->begin(), symbols->end());
+	symbols->erase(std::unique(symbols->begin(), symbols->end()), symbols->end());
+
+	return true;
+}
+
+FuzzyDictionary::FuzzyDictionary(DFA const& dictionary) : _initialState(dictionary.GetInitialState())
+{
+	if (!dictionary.HasStates())
+		return;
+
+	_table = dictionary.GetTransitionTable();
+	_finalStates.assign(_table.GetStates(), false);
+
+	StatesSet const finalStates = dictionary.GetFinalStates();
+
+	for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		if ((*itr) < _finalStates.size())
+			_finalStates[*itr] = true;
+}
+
+Vector<String> FuzzyDictionary::Find(String const& word, uint32 const& distance, uint64* visitedStates) const
+{
+	return Find(LevenshteinAutomata(word, distance), visitedStates);
+}
+
+Vector<String> FuzzyDictionary::Find(LevenshteinAutomata const& automaton, uint64* visitedStates) const
+{
+	if (_finalStates.empty())
+		return Vector<String>();
+
+	LFA_STATISTICS_OPERATION("FuzzyDictionary::Find");
+
+	// frames[depth] and rows[depth] belong to the state reached on prefix, which has depth symbols.
+	uint64 visited = 1;
+	uint32 depth = 0;
+	Vector<String> result;
+	Vector<DistanceRow> rows(1);
+	Vector<Frame> frames(1);
+	String prefix;
+
+	automaton.GetInitialRow(&rows[0]);
+	Enter(automaton, _initialState, rows[0], &frames[0]);
+
+	if (_finalStates[_initialState] && automaton.IsFinal(rows[0]))
+		result.push_back(prefix);
+
+	while (true)
+	{
+		Frame& frame = frames[depth];
+
+		if (frame.next == frame.end)
+		{
+			if (!depth)
+				break;
+
+			--depth;
+			prefix.pop_back();
+			continue;
+		}
+
+		uint32 const edge = frame.allEdges ? frame.next++ : _table.FindEdge(frame.state, frame.symbols[frame.next++]);
+
+		if (edge == TransitionTable::InvalidState)
+			continue;
+
+		if (rows.size() < depth + 2)
+		{
+			rows.resize(depth + 2);
+			frames.resize(depth + 2);
+		}
+
+		automaton.Step(rows[depth], _table.GetSymbol(edge), &rows[depth + 1]);
+
+		if (!automaton.CanMatch(rows[depth + 1]))
+			continue;
+
+		uint32 const state = *_table.GetTargets(edge).first;
+		prefix.push_back(_table.GetSymbol(edge));
+		++visited;
+
+		if (_finalStates[state] && automaton.IsFinal(rows[depth + 1]))
+			result.push_back(prefix);
+
+		++depth;
+		Enter(automaton, state, rows[depth], &frames[depth]);
+	}
+
+	if (visitedStates)
+		*visitedStates = visited;
+
+	return result;
+}
+
+void FuzzyDictionary::Enter(LevenshteinAutomata const& automaton, uint32 const& state, DistanceRow const& row, Frame* frame) const
+{
+	frame->state = state;
+	frame->allEdges = !automaton.GetMatchingSymbols(row, &frame->symbols);
+	frame->next = frame->allEdges ? _table.GetEdgesBegin(state) : 0;
+	frame->end = frame->allEdges ? _table.GetEdgesEnd(state) : static_cast<uint32>(frame->symbols.size());
+}
+
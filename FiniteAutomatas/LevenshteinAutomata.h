@@ -0,0 +1,80 @@
+#ifndef LFA_LIB_LEVENSHTEIN_AUTOMATA_H
+#define LFA_LIB_LEVENSHTEIN_AUTOMATA_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+#include "NondeterministicFiniteAutomata.h"
+#include "TransitionTable.h"
+
+typedef StatesVector DistanceRow;	// row[i] is the distance to the prefix of length i, capped at distance + 1.
+
+// Accepts the words within Levenshtein distance of word, insertions, deletions and substitutions costing one.
+// The NFA has a state for each (prefix length, errors) pair. Deletions are folded in the other moves,
+// so it has no lambda transitions.
+// IsAccepted simulates the NFA bit-parallel, one machine word per error count as in Wu and Manber,
+// when word is shorter than 64 symbols. The rows give the same automaton in deterministic form,
+// each row is one of its states, which is what FuzzyDictionary intersects a dictionary with.
+class LevenshteinAutomata
+{
+	public:
+		static uint32 const MaximumBitParallelLength = 63;
+
+		LevenshteinAutomata(String const& word, uint32 const& distance);
+
+		String const& GetWord() const { return _word; }
+		uint32 GetDistance() const { return _distance; }
+
+		// Symbols of word are always in the alphabet, the others only enter by insertions and substitutions.
+		NFA GetNFA(Set<char> const& alphabet) const;
+		DFA GetDFA(Set<char> const& alphabet) const;	// Minimal.
+
+		bool IsAccepted(String const& word) const;
+
+		void GetInitialRow(DistanceRow* row) const;
+		void Step(DistanceRow const& row, char const& key, DistanceRow* next) const;
+		bool IsFinal(DistanceRow const& row) const { return row.back() <= _distance; }
+		bool CanMatch(DistanceRow const& row) const { return *std::min_element(row.begin(), row.end()) <= _distance; }
+
+		// Once no entry of row is below the distance, only a match of the next symbol of word keeps an entry
+		// within it. Returns false if any symbol can, otherwise *symbols are the ones that can, sorted.
+		bool GetMatchingSymbols(DistanceRow const& row, String* symbols) const;
+
+	private:
+		String _word;
+		uint32 _distance;
+		Map<char, uint64> _masks;	// Bit i + 1 is set if word[i] is the symbol.
+
+		bool IsAcceptedBitParallel(String const& word) const;
+};
+
+// Dictionary DFA for approximate lookups, e.g. the minimal DFA DictionaryBuilder builds.
+// Find walks the dictionary depth-first together with the rows of a LevenshteinAutomata
+// and leaves a branch once no prefix of the query is within the distance anymore.
+// Also works for cyclic DFAs, the rows grow with every symbol past the length of the query plus the distance.
+class FuzzyDictionary
+{
+	public:
+		explicit FuzzyDictionary(DFA const& dictionary);
+
+		// Accepted words within distance of word, in symbol order. *visitedStates counts the dictionary states reached.
+		Vector<String> Find(String const& word, uint32 const& distance, uint64* visitedStates = nullptr) const;
+		Vector<String> Find(LevenshteinAutomata const& automaton, uint64* visitedStates = nullptr) const;
+
+	private:
+		struct Frame
+		{
+			uint32 state;
+			bool allEdges;		// Otherwise only the edges on symbols are tried.
+			String symbols;
+			uint32 next, end;	// Next edge or index in symbols.
+		};
+
+		TransitionTable _table;
+		uint32 _initialState;
+		Vector<bool> _finalStates;
+
+		void Enter(LevenshteinAutomata const& automaton, uint32 const& state, DistanceRow const& row, Frame* frame) const;
+};
+
+#endif
+
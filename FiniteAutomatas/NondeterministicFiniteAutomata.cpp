@@ -1,240 +1,1200 @@
-#include "PCH.h"
-#include "NondeterministicFiniteAutomata.h"
-
-NondeterministicFiniteAutomata::NondeterministicFiniteAutomata(std::ifstream& ifs)
-{
-	uint32 finalStates;
-
-	ifs >> _states >> _initialState >> finalStates;
-
-	assert(_states >= 0 && (_initialState >= 0 && _initialState < _states) 
-		&& (finalStates >= 0 && finalStates <= _states));
-
-	for (uint32 i = 0; i < finalStates; ++i)
-	{
-		uint32 finalState;
-
-		ifs >> finalState;
-		_finalStates.push_back(finalState);
-	}
-
-	while (!ifs.eof())
-	{
-		char key;
-		uint32 currentState, nextState;
-
-		ifs >> currentState >> key >> nextState;
-
-		TransitionPair pair(currentState, key);
-		TransitionMap::iterator itr = _transitionFunction.find(pair);
-
-		if (itr == _transitionFunction.end())
-			_transitionFunction.emplace(pair, StatesVector({ nextState }));
-		else
-			itr->second.push_back(nextState);
-	}
-}
-
-void NondeterministicFiniteAutomata::Reverse()
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates())
-		return;
-
-	NFA reversedNFA = GetReverse();
-
-	_states = reversedNFA._states;
-	_finalStates = reversedNFA._finalStates;
-	_initialState = reversedNFA._initialState;
-	_transitionFunction = reversedNFA._transitionFunction;
-}
-
-bool NondeterministicFiniteAutomata::IsAccepted(String const& word) const
-{
-	if (!HasStates() || !HasFinalStates() || !HasTransitions())
-		return false;
-
-	if (word.empty() && IsFinalState(LambdaClosure(_initialState)))
-		return true;
-
-	if (ToDFA().IsAccepted(word))
-		return true;
-
-	return false;
-}
-
-String NondeterministicFiniteAutomata::GenerateWord(uint32 const& length) const
-{
-	if (!HasStates() || !HasTransitions() || !HasFinalStates() || !length)
-		return String();
-
-	return ToDFA().GenerateWord(length);
-}
-
-DFA NondeterministicFiniteAutomata::ToDFA() const
-{
-	// We don't check for finalStates
-	if (!HasStates() || !HasTransitions())
-		return DFA();
-
-	// Variables to hold the subset version of the DFA.
-	Set<char> const alphabet = GetAlphabet();
-	Vector<StatesSet> States, FinalStates;
-	StatesSet InitialState(LambdaClosure(_initialState));
-	Map<Pair<StatesSet, char>, StatesSet> TransitionFunction;
-	States.push_back(InitialState);
-
-	// Construct TransitionFunction using subset construction.
-	// Cannot use iterator because we constantly add elements in States.
-	for (uint32 i = 0; i < States.size(); ++i)
-	{
-		for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
-		{
-			StatesSet _state = LambdaClosure(MoveTo(States[i], *key));
-
-			if (!_state.empty())
-			{
-				if (std::find(States.begin(), States.end(), _state) == States.end())
-					States.push_back(_state);
-
-				TransitionFunction[Pair<StatesSet, char>(States[i], *key)] = _state;
-			}
-		}
-	}
-
-	// Set final states in the subset version of the DFA.
-	for (Vector<StatesSet>::const_iterator itr = States.begin(); itr != States.end(); ++itr)
-	{
-		for (StatesSetConstIterator iter = itr->begin(); iter != itr->end(); ++iter)
-		{
-			if (IsFinalState((*iter)))
-			{
-				FinalStates.push_back(*itr);
-				break;
-			}
-		}
-	}
-
-	// Variables to hold the DFA.
-	// The new DFA has his states indexed by their index in States.
-	uint32 states = static_cast<uint32>(States.size()), initialState = 0;
-	StatesVector finalStates;
-	TransitionMap transitionFunction;
-
-	for (Vector<StatesSet>::const_iterator itr = FinalStates.begin(); itr != FinalStates.end(); ++itr)
-	{
-		for (uint32 i = 0; i < States.size(); ++i)
-			if (States[i] == (*itr))
-				finalStates.push_back(i);
-	}
-
-	for (Map<Pair<StatesSet, char>, StatesSet>::const_iterator itr = TransitionFunction.begin(); itr != TransitionFunction.end(); ++itr)
-	{
-		uint8 found = 0;
-		uint32 currentState = 0, nextState = 0;	// Initialize them to remove warning.
-
-		for (uint32 i = 0; i < States.size() && found != 2; ++i)
-		{
-			if (States[i] == itr->first.first)
-			{
-				currentState = i;
-				++found;
-			}
-
-			if (States[i] == itr->second)
-			{
-				nextState = i;
-				++found;
-			}
-		}
-
-		if (found == 2)
-			transitionFunction.emplace(TransitionPair(currentState, itr->first.second), StatesVector({ nextState }));
-	}
-
-	return DFA(states, initialState, finalStates, transitionFunction);
-}
-
-StatesSet NondeterministicFiniteAutomata::LambdaClosure(uint32 const& state) const
-{
-	StatesSet closure;
-	Queue<uint32> queue;
-	Vector<bool> visited(_states, false);
-
-	queue.push(state);
-	closure.insert(state);
-	visited[state] = true;
-
-	while (!queue.empty())
-	{
-		uint32 currentState = queue.front();
-
-		TransitionMapConstIterator itr = _transitionFunction.find(TransitionPair(currentState, '0'));
-
-		if (itr != _transitionFunction.end())
-		{
-			for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
-			{
-				if (!visited[(*iter)])
-				{
-					closure.insert((*iter));
-					queue.push((*iter));
-					visited[(*iter)] = true;
-				}
-			}
-		}
-
-		queue.pop();
-	}
-
-	return closure;
-}
-
-StatesSet NondeterministicFiniteAutomata::LambdaClosure(StatesSet const& states) const
-{
-	if (states.empty())
-		return StatesSet();
-
-	StatesSet closure;
-
-	for (StatesSetConstIterator itr = states.begin(); itr != states.end(); ++itr)
-	{
-		StatesSet _closure = LambdaClosure(*itr);
-		std::set_union(_closure.begin(), _closure.end(), closure.begin(), closure.end(), std::inserter(closure, closure.begin()));
-	}
-
-	return closure;
-}
-
-StatesSet NondeterministicFiniteAutomata::MoveTo(uint32 const& state, char const& key) const
-{
-	TransitionMapConstIterator itr = _transitionFunction.find(TransitionPair(state, key));
-
-	if (itr != _transitionFunction.end())
-	{
-		StatesSet closure;
-
-		for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
-			closure.insert(*iter);
-
-		return closure;
-	}
-
-	return StatesSet();
-}
-
-StatesSet NondeterministicFiniteAutomata::MoveTo(StatesSet const& states, char const& key) const
-{
-	if (states.empty())
-		return StatesSet();
-
-	StatesSet closure;
-
-	for (StatesSetConstIterator itr = states.begin(); itr != states.end(); ++itr)
-	{
-		StatesSet _closure = MoveTo(*itr, key);
-		std::set_union(_closure.begin(), _closure.end(), closure.begin(), closure.end(), inserter(closure, closure.begin()));
-	}
-
-	return closure;
-}
-
+#include "PCH.h"
+#include "NondeterministicFiniteAutomata.h"
+#include "TransitionTable.h"
+#include "Statistics.h"
+
+namespace
+{
+	typedef Pair<uint32, StatesVector const*> SubsetItem;
+
+	uint64 HashSubset(StatesVector const& subset)
+	{
+		// FNV-1a
+		uint64 hash = 14695981039346656037ULL;
+
+		for (StatesConstIterator itr = subset.begin(); itr != subset.end(); ++itr)
+		{
+			hash ^= (*itr);
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	// Subset table shared by the determinization workers. Subsets are spread over
+	// independently locked shards and get dense ids from a shared counter.
+	class ConcurrentSubsetTable
+	{
+		public:
+			ConcurrentSubsetTable() : _size(0) { }
+
+			// The subset pointer stays valid as long as the table lives.
+			SubsetItem Insert(StatesVector const& subset, bool* inserted)
+			{
+				Shard& shard = _shards[HashSubset(subset) % Shards];
+				std::lock_guard<std::mutex> lock(shard.mutex);
+
+				Map<StatesVector, uint32>::const_iterator itr = shard.subsets.find(subset);
+				*inserted = (itr == shard.subsets.end());
+
+				if (*inserted)
+					itr = shard.subsets.emplace(subset, _size++).first;
+
+				return SubsetItem(itr->second, &itr->first);
+			}
+
+			uint32 GetSize() const { return _size.load(); }
+
+		private:
+			static uint32 const Shards = 64;
+
+			struct Shard
+			{
+				std::mutex mutex;
+				Map<StatesVector, uint32> subsets;
+			};
+
+			Shard _shards[Shards];
+			std::atomic<uint32> _size;
+	};
+
+	// Subset construction with work stealing. Every worker owns a deque of subsets to expand:
+	// it pushes and pops new subsets at the back and, when it runs dry, steals from the front of the others.
+	// Transitions go to per worker buffers that are merged once every worker has finished.
+	class ParallelDeterminization
+	{
+		public:
+			ParallelDeterminization(TransitionTable const& table, TransitionTable const& lambdaTable, Set<char> const& alphabet,
+				Vector<bool> const& finalStates, uint32 const& workers) : _table(table), _lambdaTable(lambdaTable), _alphabet(alphabet), _finalStates(finalStates), _pending(0), 
+				_queues(workers), _outputs(workers) { }
+
+			void Run(StatesVector const& initialSubset)
+			{
+				bool inserted;
+				_pending = 1;
+				_queues[0].items.push_back(_subsets.Insert(initialSubset, &inserted));
+
+				Vector<std::thread> threads;
+
+				for (uint32 i = 1; i < _queues.size(); ++i)
+					threads.emplace_back(&ParallelDeterminization::Work, this, i);
+
+				Work(0);
+
+				for (uint32 i = 0; i < threads.size(); ++i)
+					threads[i].join();
+			}
+
+			DFA BuildDFA()
+			{
+				uint64 subsetsStates = 0;
+				StatesVector finalStates;
+				TransitionsVector transitions;
+
+				for (uint32 i = 0; i < _outputs.size(); ++i)
+				{
+					subsetsStates += _outputs[i].subsetsStates;
+					finalStates.insert(finalStates.end(), _outputs[i].finalStates.begin(), _outputs[i].finalStates.end());
+					transitions.insert(transitions.end(), _outputs[i].transitions.begin(), _outputs[i].transitions.end());
+					_outputs[i] = WorkerOutput();
+				}
+
+				LFA_STATISTICS_ADD(subsetsExplored, _subsets.GetSize());
+				LFA_STATISTICS_ADD(subsetsStates, subsetsStates);
+
+				std::sort(finalStates.begin(), finalStates.end());
+
+				return DFA(_subsets.GetSize(), 0, std::move(finalStates), TransitionTable(_subsets.GetSize(), std::move(transitions)));
+			}
+
+		private:
+			struct WorkQueue
+			{
+				std::mutex mutex;
+				std::deque<SubsetItem> items;
+			};
+
+			struct WorkerOutput
+			{
+				uint64 subsetsStates;
+				StatesVector finalStates;
+				TransitionsVector transitions;
+
+				WorkerOutput() : subsetsStates(0) { }
+			};
+
+			TransitionTable const& _table;
+			TransitionTable const& _lambdaTable;
+			Set<char> const& _alphabet;
+			Vector<bool> const& _finalStates;
+
+			ConcurrentSubsetTable _subsets;
+			std::atomic<uint64> _pending;	// Subsets discovered but not expanded yet.
+			Vector<WorkQueue> _queues;
+			Vector<WorkerOutput> _outputs;
+
+			bool Pop(uint32 const& worker, SubsetItem* item)
+			{
+				{
+					WorkQueue& queue = _queues[worker];
+					std::lock_guard<std::mutex> lock(queue.mutex);
+
+					if (!queue.items.empty())
+					{
+						*item = queue.items.back();
+						queue.items.pop_back();
+						return true;
+					}
+				}
+
+				for (uint32 i = 1; i < _queues.size(); ++i)
+				{
+					WorkQueue& queue = _queues[(worker + i) % _queues.size()];
+					std::lock_guard<std::mutex> lock(queue.mutex);
+
+					if (!queue.items.empty())
+					{
+						*item = queue.items.front();
+						queue.items.pop_front();
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+			void Work(uint32 const& worker)
+			{
+				uint32 stamp = 0;
+				StatesVector subset, marks(_table.GetStates(), TransitionTable::InvalidState);
+				WorkerOutput& output = _outputs[worker];
+				SubsetItem item;
+
+				while (true)
+				{
+					if (!Pop(worker, &item))
+					{
+						if (!_pending.load())
+							return;
+
+						std::this_thread::yield();
+						continue;
+					}
+
+					StatesVector const& current = *item.second;
+					output.subsetsStates += current.size();
+
+					for (StatesConstIterator itr = current.begin(); itr != current.end(); ++itr)
+						if (_finalStates[*itr])
+						{
+							output.finalStates.push_back(item.first);
+							break;
+						}
+
+					for (Set<char>::const_iterator key = _alphabet.begin(); key != _alphabet.end(); ++key)
+					{
+						++stamp;
+						subset.clear();
+						_table.AddTargets(current, *key, &subset, &marks, stamp);
+
+						if (subset.empty())
+							continue;
+
+						_lambdaTable.AddClosure(FiniteAutomata::Lambda, &subset, &marks, stamp);
+
+						bool inserted;
+						SubsetItem next = _subsets.Insert(subset, &inserted);
+
+						if (inserted)
+						{
+							++_pending;
+
+							WorkQueue& queue = _queues[worker];
+							std::lock_guard<std::mutex> lock(queue.mutex);
+							queue.items.push_back(next);
+						}
+
+						output.transitions.emplace_back(TransitionPair(item.first, *key), next.first);
+					}
+
+					--_pending;
+				}
+			}
+	};
+
+	// Record of the spill files of the external determinization: a sorted subset followed by the
+	// id of the subset, or by the source state and symbol of a transition into it.
+	struct SpillRecord
+	{
+		StatesVector subset;
+		uint32 value;
+		char key;
+
+		SpillRecord() : value(0), key(0) { }
+
+		bool operator<(SpillRecord const& other) const { return subset < other.subset; }
+	};
+
+	void WriteRecord(std::ofstream& ofs, SpillRecord const& record)
+	{
+		uint32 const size = static_cast<uint32>(record.subset.size());
+
+		ofs.write(reinterpret_cast<char const*>(&size), sizeof(size));
+		ofs.write(reinterpret_cast<char const*>(record.subset.data()), size * sizeof(uint32));
+		ofs.write(reinterpret_cast<char const*>(&record.value), sizeof(record.value));
+		ofs.put(record.key);
+	}
+
+	bool ReadRecord(std::ifstream& ifs, SpillRecord* record)
+	{
+		uint32 size;
+
+		if (!ifs.read(reinterpret_cast<char*>(&size), sizeof(size)))
+			return false;
+
+		record->subset.resize(size);
+		ifs.read(reinterpret_cast<char*>(record->subset.data()), size * sizeof(uint32));
+		ifs.read(reinterpret_cast<char*>(&record->value), sizeof(record->value));
+		ifs.get(record->key);
+
+		return static_cast<bool>(ifs);
+	}
+
+	struct SpillReader
+	{
+		std::ifstream ifs;
+		SpillRecord current;
+		bool valid;
+
+		explicit SpillReader(String const& path) : ifs(path, std::ios::binary), valid(false) { Next(); }
+
+		void Next() { valid = ReadRecord(ifs, &current); }
+	};
+
+	typedef std::unique_ptr<SpillReader> SpillReaderPtr;
+
+	// Subset construction for DFAs which do not fit in memory, run one breadth-first layer at a time.
+	// The frontier file holds the subsets of the current layer. Expanding it buffers the transitions
+	// out of the layer and spills them to runs sorted by target subset whenever the buffer reaches memoryLimit bytes.
+	// The runs are then merged with the visited file, which holds every subset found so far sorted with its id:
+	// the targets missing from it get the next ids and make up the next frontier. A subset can be reached again
+	// from any later layer, so deduplicating against the whole visited file is what numbers it only once.
+	// Transitions and final states are streamed to files in the binary format of DFA::WriteBinary and copied to the output by Write.
+	class ExternalDeterminization
+	{
+		public:
+			ExternalDeterminization(TransitionTable const& table, TransitionTable const& lambdaTable, Set<char> const& alphabet,
+				Vector<bool> const& finalStates, String const& directory, uint64 const& memoryLimit) : _table(table), _lambdaTable(lambdaTable), _alphabet(alphabet), _finalStates(finalStates),
+				_directory(directory), _memoryLimit(memoryLimit), _filesCreated(0), _states(0), _finalStatesCount(0), _transitionsCount(0)
+			{
+				static std::atomic<uint32> instances(0);
+
+				// Runs sharing the directory with another determinization keep apart by the prefix.
+				_prefix = "lfa-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-" + 
+					std::to_string(instances++) + "-";
+
+				_transitionsPath = NewFile();
+				_finalStatesPath = NewFile();
+				_transitions.open(_transitionsPath, std::ios::binary);
+				_finalStatesOutput.open(_finalStatesPath, std::ios::binary);
+			}
+
+			~ExternalDeterminization()
+			{
+				_transitions.close();
+				_finalStatesOutput.close();
+
+				while (!_files.empty())
+					RemoveFile(*_files.begin());
+			}
+
+			bool Run(StatesVector const& initialSubset)
+			{
+				SpillRecord initial;
+				initial.subset = initialSubset;
+
+				String frontier = NewFile(), visited = NewFile();
+
+				{
+					std::ofstream frontierOutput(frontier, std::ios::binary), visitedOutput(visited, std::ios::binary);
+
+					WriteRecord(frontierOutput, initial);
+					WriteRecord(visitedOutput, initial);
+					AddState(initial.subset);
+
+					frontierOutput.close();
+					visitedOutput.close();
+
+					if (!frontierOutput || !visitedOutput)
+						return false;
+				}
+
+				while (true)
+				{
+					Vector<String> runs;
+
+					if (!Expand(frontier, &runs))
+						return false;
+
+					RemoveFile(frontier);
+
+					if (runs.empty())
+						break;
+
+					// Merging more runs at once would keep too many files open.
+					while (runs.size() > MergeFanIn)
+					{
+						Vector<String> merged;
+
+						for (uint32 i = 0; i < runs.size(); i += MergeFanIn)
+						{
+							Vector<String> group(runs.begin() + i, runs.begin() + std::min<size_t>(i + MergeFanIn, runs.size()));
+							merged.push_back(NewFile());
+
+							if (!Merge(group, merged.back()))
+								return false;
+						}
+
+						runs.swap(merged);
+					}
+
+					if (!NumberTargets(runs, &visited, &frontier))
+						return false;
+				}
+
+				RemoveFile(visited);
+
+				return _transitions && _finalStatesOutput;
+			}
+
+			// The DFA in the format of DFA::WriteBinary, the initial state is 0.
+			bool Write(std::ofstream& ofs)
+			{
+				_transitions.close();
+				_finalStatesOutput.close();
+
+				DFA::WriteBinaryHeader(ofs, _states, _states, 0, _finalStatesCount, _transitionsCount);
+
+				// Copying an empty file would set failbit.
+				if (_finalStatesCount)
+				{
+					std::ifstream ifs(_finalStatesPath, std::ios::binary);
+					ofs << ifs.rdbuf();
+				}
+
+				if (_transitionsCount)
+				{
+					std::ifstream ifs(_transitionsPath, std::ios::binary);
+					ofs << ifs.rdbuf();
+				}
+
+				return static_cast<bool>(ofs);
+			}
+
+		private:
+			static uint32 const MergeFanIn = 64;
+
+			TransitionTable const& _table;
+			TransitionTable const& _lambdaTable;
+			Set<char> const& _alphabet;
+			Vector<bool> const& _finalStates;
+			String const _directory;
+			uint64 const _memoryLimit;
+
+			String _prefix;
+			Set<String> _files;		// Every file still on disk, removed by the destructor if a step fails.
+			uint32 _filesCreated;
+
+			uint32 _states;
+			uint32 _finalStatesCount;
+			uint64 _transitionsCount;
+			String _transitionsPath;
+			String _finalStatesPath;
+			std::ofstream _transitions;
+			std::ofstream _finalStatesOutput;
+
+			String NewFile()
+			{
+				String path = _directory + "/" + _prefix + std::to_string(_filesCreated++);
+
+				_files.insert(path);
+				return path;
+			}
+
+			void RemoveFile(String const& path)
+			{
+				remove(path.c_str());
+				_files.erase(path);
+			}
+
+			uint32 AddState(StatesVector const& subset)
+			{
+				uint32 const state = _states++;
+
+				for (StatesConstIterator itr = subset.begin(); itr != subset.end(); ++itr)
+					if (_finalStates[*itr])
+					{
+						_finalStatesOutput.write(reinterpret_cast<char const*>(&state), sizeof(state));
+						++_finalStatesCount;
+						break;
+					}
+
+				return state;
+			}
+
+			bool Expand(String const& frontier, Vector<String>* runs)
+			{
+				LFA_STATISTICS_PHASE("Expand");
+
+				uint32 stamp = 0;
+				uint64 bytes = 0;
+				StatesVector marks(_table.GetStates(), TransitionTable::InvalidState);
+				Vector<SpillRecord> buffer;
+				SpillReader reader(frontier);
+
+				for (; reader.valid; reader.Next())
+				{
+					LFA_STATISTICS_ADD(subsetsExplored, 1);
+					LFA_STATISTICS_ADD(subsetsStates, reader.current.subset.size());
+
+					for (Set<char>::const_iterator key = _alphabet.begin(); key != _alphabet.end(); ++key)
+					{
+						SpillRecord record;
+
+						++stamp;
+						_table.AddTargets(reader.current.subset, *key, &record.subset, &marks, stamp);
+
+						if (record.subset.empty())
+							continue;
+
+						_lambdaTable.AddClosure(FiniteAutomata::Lambda, &record.subset, &marks, stamp);
+						record.value = reader.current.value;
+						record.key = *key;
+
+						bytes += sizeof(SpillRecord) + record.subset.size() * sizeof(uint32);
+						buffer.push_back(std::move(record));
+
+						if (bytes >= _memoryLimit)
+						{
+							if (!Spill(&buffer, runs))
+								return false;
+
+							bytes = 0;
+						}
+					}
+				}
+
+				return reader.ifs.eof() && Spill(&buffer, runs);
+			}
+
+			bool Spill(Vector<SpillRecord>* buffer, Vector<String>* runs)
+			{
+				if (buffer->empty())
+					return true;
+
+				std::sort(buffer->begin(), buffer->end());
+				runs->push_back(NewFile());
+
+				std::ofstream ofs(runs->back(), std::ios::binary);
+
+				for (Vector<SpillRecord>::const_iterator itr = buffer->begin(); itr != buffer->end(); ++itr)
+					WriteRecord(ofs, *itr);
+
+				buffer->clear();
+				ofs.close();
+
+				return static_cast<bool>(ofs);
+			}
+
+			// Readers of runs ordered by their current record, the smallest on top.
+			typedef std::priority_queue<uint32, Vector<uint32>, std::function<bool(uint32, uint32)>> MergeHeap;
+
+			static MergeHeap OpenRuns(Vector<String> const& runs, Vector<SpillReaderPtr>* readers)
+			{
+				MergeHeap heap([readers](uint32 first, uint32 second) { return (*readers)[second]->current < (*readers)[first]->current; });
+
+				for (Vector<String>::const_iterator itr = runs.begin(); itr != runs.end(); ++itr)
+				{
+					readers->emplace_back(new SpillReader(*itr));
+
+					if (readers->back()->valid)
+						heap.push(static_cast<uint32>(readers->size() - 1));
+				}
+
+				return heap;
+			}
+
+			bool Merge(Vector<String> const& runs, String const& output)
+			{
+				LFA_STATISTICS_PHASE("Merge");
+
+				Vector<SpillReaderPtr> readers;
+				MergeHeap heap = OpenRuns(runs, &readers);
+				std::ofstream ofs(output, std::ios::binary);
+
+				while (!heap.empty())
+				{
+					uint32 const run = heap.top();
+					heap.pop();
+
+					WriteRecord(ofs, readers[run]->current);
+					readers[run]->Next();
+
+					if (readers[run]->valid)
+						heap.push(run);
+				}
+
+				for (uint32 i = 0; i < runs.size(); ++i)
+				{
+					if (!readers[i]->ifs.eof())
+						return false;
+
+					readers[i].reset();
+					RemoveFile(runs[i]);
+				}
+
+				ofs.close();
+				return static_cast<bool>(ofs);
+			}
+
+			// Merges the runs with the visited file. Each target subset keeps its id if visited and gets
+			// the next one otherwise, the new subsets go to the next frontier and the merged visited file.
+			bool NumberTargets(Vector<String> const& runs, String* visited, String* frontier)
+			{
+				LFA_STATISTICS_PHASE("Merge");
+
+				Vector<SpillReaderPtr> readers;
+				MergeHeap heap = OpenRuns(runs, &readers);
+				SpillReader visitedReader(*visited);
+				String const nextVisited = NewFile(), nextFrontier = NewFile();
+				std::ofstream visitedOutput(nextVisited, std::ios::binary), frontierOutput(nextFrontier, std::ios::binary);
+				SpillRecord target;
+				bool hasTarget = false;
+
+				while (!heap.empty())
+				{
+					uint32 const run = heap.top();
+					SpillRecord const& record = readers[run]->current;
+
+					heap.pop();
+
+					if (!hasTarget || target.subset != record.subset)
+					{
+						// The visited subsets before this one keep their ids. If it is visited itself, it is copied with the ones after it.
+						while (visitedReader.valid && visitedReader.current.subset < record.subset)
+						{
+							WriteRecord(visitedOutput, visitedReader.current);
+							visitedReader.Next();
+						}
+
+						target.subset = record.subset;
+						hasTarget = true;
+
+						if (visitedReader.valid && visitedReader.current.subset == record.subset)
+							target.value = visitedReader.current.value;
+						else
+						{
+							assert(_states != TransitionTable::InvalidState);
+
+							target.value = AddState(target.subset);
+							WriteRecord(visitedOutput, target);
+							WriteRecord(frontierOutput, target);
+						}
+					}
+
+					DFA::WriteBinaryTransition(_transitions, record.value, record.key, target.value);
+					++_transitionsCount;
+
+					readers[run]->Next();
+
+					if (readers[run]->valid)
+						heap.push(run);
+				}
+
+				for (; visitedReader.valid; visitedReader.Next())
+					WriteRecord(visitedOutput, visitedReader.current);
+
+				visitedOutput.close();
+				frontierOutput.close();
+
+				if (!visitedReader.ifs.eof() || !visitedOutput || !frontierOutput)
+					return false;
+
+				for (uint32 i = 0; i < runs.size(); ++i)
+				{
+					if (!readers[i]->ifs.eof())
+						return false;
+
+					readers[i].reset();
+					RemoveFile(runs[i]);
+				}
+
+				visitedReader.ifs.close();
+				RemoveFile(*visited);
+
+				*visited = nextVisited;
+				*frontier = nextFrontier;
+				return true;
+			}
+	};
+
+	// Transitions between the states marked in keep, which are numbered in increasing order.
+	// Returns the number of kept states.
+	uint32 KeepStates(TransitionTable const& table, Vector<bool> const& keep, StatesVector* numbering, TransitionsVector* transitions)
+	{
+		uint32 states = 0;
+
+		numbering->assign(table.GetStates(), TransitionTable::InvalidState);
+		transitions->clear();
+
+		for (uint32 state = 0; state < table.GetStates(); ++state)
+			if (keep[state])
+				(*numbering)[state] = states++;
+
+		for (uint32 state = 0; state < table.GetStates(); ++state)
+			if (keep[state])
+				for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+				{
+					TargetsRange targets = table.GetTargets(edge);
+
+					for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+						if (keep[*itr])
+							transitions->emplace_back(TransitionPair((*numbering)[state], table.GetSymbol(edge)), (*numbering)[*itr]);
+				}
+
+		return states;
+	}
+
+	// Forward direct simulation of a lambda free automaton. other simulates state if other is final
+	// whenever state is, and every move of state is matched by a move of other with the same
+	// symbol to a state simulating the target. Each state keeps the bitset of the states simulating it,
+	// refined to the greatest fixpoint: when a row shrinks, the rows of its predecessors are rechecked.
+	class SimulationRelation
+	{
+		public:
+			SimulationRelation(TransitionTable const& table, Vector<bool> const& finalStates) : 
+				_words((table.GetStates() + 63) / 64), _rows(table.GetStates() * _words, 0)
+			{
+				uint32 const states = table.GetStates();
+				TransitionTable const reverse = table.GetReverse();
+				Vector<uint64> predecessors(_words);
+				Vector<bool> queued(states, true);
+				Queue<uint32> worklist;
+
+				for (uint32 state = 0; state < states; ++state)
+				{
+					for (uint32 other = 0; other < states; ++other)
+						if (!finalStates[state] || finalStates[other])
+							_rows[state * _words + other / 64] |= 1ULL << (other % 64);
+
+					worklist.push(state);
+				}
+
+				while (!worklist.empty())
+				{
+					uint32 const target = worklist.front();
+
+					worklist.pop();
+					queued[target] = false;
+
+					LFA_STATISTICS_ADD(refinementRounds, 1);
+
+					// A state with a move into target can only be simulated by the states
+					// with a move on the same symbol into a state simulating target.
+					for (uint32 edge = reverse.GetEdgesBegin(target); edge < reverse.GetEdgesEnd(target); ++edge)
+					{
+						char const key = reverse.GetSymbol(edge);
+
+						std::fill(predecessors.begin(), predecessors.end(), 0);
+
+						for (uint32 other = 0; other < states; ++other)
+							if (Simulates(target, other))
+							{
+								TargetsRange targets = reverse.Find(other, key);
+
+								for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+									predecessors[(*itr) / 64] |= 1ULL << ((*itr) % 64);
+							}
+
+						TargetsRange targets = reverse.GetTargets(edge);
+
+						for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+						{
+							bool changed = false;
+
+							for (uint32 i = 0; i < _words; ++i)
+							{
+								uint64& row = _rows[(*itr) * _words + i];
+
+								changed |= (row & predecessors[i]) != row;
+								row &= predecessors[i];
+							}
+
+							if (changed)
+							{
+								LFA_STATISTICS_ADD(refinementSplits, 1);
+
+								if (!queued[*itr])
+								{
+									queued[*itr] = true;
+									worklist.push(*itr);
+								}
+							}
+						}
+					}
+				}
+			}
+
+			bool Simulates(uint32 const& state, uint32 const& other) const	// other simulates state.
+			{
+				return ((_rows[state * _words + other / 64] >> (other % 64)) & 1) != 0;
+			}
+
+		private:
+			uint32 _words;
+			Vector<uint64> _rows;
+	};
+}
+
+NondeterministicFiniteAutomata::NondeterministicFiniteAutomata(std::ifstream& ifs)
+{
+	uint32 finalStates;
+
+	ifs >> _states >> _initialState >> finalStates;
+
+	assert(_states >= 0 && (_initialState >= 0 && _initialState < _states) 
+		&& (finalStates >= 0 && finalStates <= _states));
+
+	for (uint32 i = 0; i < finalStates; ++i)
+	{
+		uint32 finalState;
+
+		ifs >> finalState;
+		_finalStates.GetMutable().push_back(finalState);
+	}
+
+	char key;
+	uint32 currentState, nextState;
+	TransitionsVector transitions, lambdaTransitions;
+
+	while (ifs >> currentState >> key >> nextState)
+		((key == Lambda) ? lambdaTransitions : transitions).emplace_back(TransitionPair(currentState, key), nextState);
+
+	SetTransitions(std::move(transitions), std::move(lambdaTransitions));
+}
+
+NondeterministicFiniteAutomata::NondeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+	Vector<uint32> const& finalStates, TransitionMap const& transitionFunction)
+{
+	TransitionsVector transitions, lambdaTransitions;
+
+	_states = states;
+	_initialState = initialState;
+	_finalStates = finalStates;
+
+	for (TransitionMapConstIterator itr = transitionFunction.begin(); itr != transitionFunction.end(); ++itr)
+		for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
+			((itr->first.second == Lambda) ? lambdaTransitions : transitions).emplace_back(itr->first, *iter);
+
+	SetTransitions(std::move(transitions), std::move(lambdaTransitions));
+}
+
+void NondeterministicFiniteAutomata::Reverse()
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates())
+		return;
+
+	*this = GetReverse();
+}
+
+bool NondeterministicFiniteAutomata::IsAccepted(String const& word) const
+{
+	if (!HasStates() || !HasFinalStates())
+		return false;
+
+	LFA_STATISTICS_OPERATION("IsAccepted");
+
+	if (word.empty() && IsFinalState(LambdaClosure(GetLambdaTable(), _initialState)))
+		return true;
+
+	if (ToDFA().IsAccepted(word))
+		return true;
+
+	return false;
+}
+
+String NondeterministicFiniteAutomata::GenerateWord(uint32 const& length) const
+{
+	if (!HasStates() || !HasTransitions() || !HasFinalStates() || !length)
+		return String();
+
+	return ToDFA().GenerateWord(length);
+}
+
+bool NondeterministicFiniteAutomata::Write(std::ofstream& ofs) const
+{
+	// The input files read every transition on Lambda as a lambda transition.
+	if (GetAlphabet().count(Lambda))
+		return false;
+
+	return FiniteAutomata::Write(ofs);
+}
+
+void NondeterministicFiniteAutomata::Reduce()
+{
+	if (!HasStates())
+		return;
+
+	*this = GetReduced();
+}
+
+NFA NondeterministicFiniteAutomata::GetReduced() const
+{
+	if (!HasStates())
+		return NFA();
+
+	LFA_STATISTICS_OPERATION("Reduce");
+
+	TransitionTable const& table = GetTransitionTable();
+	TransitionTable const& lambdaTable = GetLambdaTable();
+	uint32 const states = table.GetStates();
+	Vector<bool> finalStates(states, false);
+	TransitionsVector transitions;
+	StatesVector numbering;
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		if ((*itr) < states)
+			finalStates[*itr] = true;
+
+	// Every state takes over the moves and the finality of its lambda closure.
+	{
+		LFA_STATISTICS_PHASE("LambdaElimination");
+
+		StatesVector closure, marks(states, TransitionTable::InvalidState);
+		Vector<bool> closureFinalStates(states, false);
+
+		for (uint32 state = 0; state < states; ++state)
+		{
+			closure.assign(1, state);
+			marks[state] = state;
+			lambdaTable.AddClosure(Lambda, &closure, &marks, state);
+
+			for (StatesConstIterator itr = closure.begin(); itr != closure.end(); ++itr)
+			{
+				if (finalStates[*itr])
+					closureFinalStates[state] = true;
+
+				for (uint32 edge = table.GetEdgesBegin(*itr); edge < table.GetEdgesEnd(*itr); ++edge)
+				{
+					TargetsRange targets = table.GetTargets(edge);
+
+					for (uint32 const* iter = targets.first; iter != targets.second; ++iter)
+						transitions.emplace_back(TransitionPair(state, table.GetSymbol(edge)), *iter);
+				}
+			}
+		}
+
+		finalStates.swap(closureFinalStates);
+	}
+
+	TransitionTable current(states, std::move(transitions));
+	Vector<bool> useful = current.GetUsefulStates(_initialState, finalStates);
+
+	if (!useful[_initialState])
+		return NFA(1, 0, StatesVector(), TransitionTable(1, TransitionsVector()));
+
+	uint32 initialState = _initialState;
+	uint32 count = KeepStates(current, useful, &numbering, &transitions);
+
+	initialState = numbering[initialState];
+
+	for (uint32 state = 0; state < states; ++state)
+		if (useful[state])
+			finalStates[numbering[state]] = finalStates[state];
+
+	finalStates.resize(count);
+	current = TransitionTable(count, std::move(transitions));
+
+	// States simulating each other are merged, the class of a state is numbered after its first member.
+	StatesVector classes(count), members;
+
+	{
+		LFA_STATISTICS_PHASE("Simulation");
+
+		SimulationRelation const simulation(current, finalStates);
+
+		for (uint32 state = 0; state < count; ++state)
+		{
+			uint32 member = 0;
+
+			while (member < members.size() && !(simulation.Simulates(state, members[member]) && simulation.Simulates(members[member], state)))
+				++member;
+
+			if (member == members.size())
+				members.push_back(state);
+
+			classes[state] = member;
+		}
+
+		transitions.clear();
+
+		for (uint32 state = 0; state < count; ++state)
+			for (uint32 edge = current.GetEdgesBegin(state); edge < current.GetEdgesEnd(state); ++edge)
+			{
+				TargetsRange targets = current.GetTargets(edge);
+
+				for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+					transitions.emplace_back(TransitionPair(classes[state], current.GetSymbol(edge)), classes[*itr]);
+			}
+
+		TransitionTable const merged(static_cast<uint32>(members.size()), std::move(transitions));
+
+		// A move to a state simulated by another target of the same move is redundant,
+		// every word accepted through it is also accepted through the other one.
+		transitions.clear();
+
+		for (uint32 state = 0; state < merged.GetStates(); ++state)
+			for (uint32 edge = merged.GetEdgesBegin(state); edge < merged.GetEdgesEnd(state); ++edge)
+			{
+				TargetsRange targets = merged.GetTargets(edge);
+
+				for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				{
+					uint32 const* iter = targets.first;
+
+					while (iter != targets.second && (iter == itr || !simulation.Simulates(members[*itr], members[*iter])))
+						++iter;
+
+					if (iter == targets.second)
+						transitions.emplace_back(TransitionPair(state, merged.GetSymbol(edge)), *itr);
+				}
+			}
+	}
+
+	Vector<bool> classFinalStates(members.size(), false);
+
+	for (uint32 member = 0; member < members.size(); ++member)
+		classFinalStates[member] = finalStates[members[member]];
+
+	current = TransitionTable(static_cast<uint32>(members.size()), std::move(transitions));
+	initialState = classes[initialState];
+	useful = current.GetUsefulStates(initialState, classFinalStates);
+	count = KeepStates(current, useful, &numbering, &transitions);
+
+	StatesVector reducedFinalStates;
+
+	for (uint32 state = 0; state < current.GetStates(); ++state)
+		if (useful[state] && classFinalStates[state])
+			reducedFinalStates.push_back(numbering[state]);
+
+	return NFA(count, numbering[initialState], std::move(reducedFinalStates), TransitionTable(count, std::move(transitions)));
+}
+
+DFA NondeterministicFiniteAutomata::ToDFA() const
+{
+	// We don't check for finalStates
+	if (!HasStates())
+		return DFA();
+
+	if (!HasTransitions())
+		return DFA(1, 0, IsFinalState(_initialState) ? StatesVector({ 0 }) : StatesVector(), TransitionTable(1, TransitionsVector()));
+
+	// Subsets of states which cannot reach a final state only add dead states to the DFA.
+	Vector<bool> const useful = GetUsefulStates();
+
+	if (std::find(useful.begin(), useful.end(), false) != useful.end())
+	{
+		NondeterministicFiniteAutomata trimmed(*this);
+		trimmed.Trim();
+		return trimmed.ToDFA();
+	}
+
+	LFA_STATISTICS_OPERATION("ToDFA");
+
+	Set<char> const alphabet = GetAlphabet();
+	TransitionTable const& table = GetTransitionTable();
+	TransitionTable const& lambdaTable = GetLambdaTable();
+
+	// The new DFA has his states indexed by their index in States.
+	Vector<StatesSet> States;
+	Map<StatesSet, uint32> StatesIndex;
+	StatesVector finalStates;
+	TransitionsVector transitions;
+
+	States.push_back(LambdaClosure(lambdaTable, _initialState));
+	StatesIndex.emplace(States.back(), 0);
+
+	LFA_STATISTICS_PHASE("SubsetConstruction");
+
+	// Construct the DFA using subset construction.
+	// Cannot use iterator because we constantly add elements in States.
+	for (uint32 i = 0; i < States.size(); ++i)
+	{
+		LFA_STATISTICS_ADD(subsetsExplored, 1);
+		LFA_STATISTICS_ADD(subsetsStates, States[i].size());
+
+		if (IsFinalState(States[i]))
+			finalStates.push_back(i);
+
+		for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
+		{
+			StatesSet _state = LambdaClosure(lambdaTable, MoveTo(table, States[i], *key));
+
+			if (_state.empty())
+				continue;
+
+			Map<StatesSet, uint32>::const_iterator itr = StatesIndex.find(_state);
+			uint32 nextState;
+
+			if (itr == StatesIndex.end())
+			{
+				nextState = static_cast<uint32>(States.size());
+				StatesIndex.emplace(_state, nextState);
+				States.push_back(_state);
+			}
+			else
+				nextState = itr->second;
+
+			transitions.emplace_back(TransitionPair(i, *key), nextState);
+		}
+	}
+
+	uint32 const states = static_cast<uint32>(States.size());
+
+	return DFA(states, 0, std::move(finalStates), TransitionTable(states, std::move(transitions)));
+}
+
+DFA NondeterministicFiniteAutomata::ToDFAParallel(uint32 threads, bool canonicalNumbering) const
+{
+	// We don't check for finalStates
+	if (!HasStates())
+		return DFA();
+
+	if (!HasTransitions())
+		return DFA(1, 0, IsFinalState(_initialState) ? StatesVector({ 0 }) : StatesVector(), TransitionTable(1, TransitionsVector()));
+
+	// Subsets of states which cannot reach a final state only add dead states to the DFA.
+	Vector<bool> const useful = GetUsefulStates();
+
+	if (std::find(useful.begin(), useful.end(), false) != useful.end())
+	{
+		NondeterministicFiniteAutomata trimmed(*this);
+		trimmed.Trim();
+		return trimmed.ToDFAParallel(threads, canonicalNumbering);
+	}
+
+	LFA_STATISTICS_OPERATION("ToDFA");
+
+	if (!threads)
+		threads = std::max(std::thread::hardware_concurrency(), 1U);
+
+	Set<char> const alphabet = GetAlphabet();
+	TransitionTable const& table = GetTransitionTable();
+	Vector<bool> finalStates(table.GetStates(), false);
+	StatesVector initialSubset({ _initialState }), marks(table.GetStates(), TransitionTable::InvalidState);
+	DFA dfa;
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		if ((*itr) < finalStates.size())
+			finalStates[*itr] = true;
+
+	marks[_initialState] = 0;
+	GetLambdaTable().AddClosure(Lambda, &initialSubset, &marks, 0);
+
+	{
+		LFA_STATISTICS_PHASE("SubsetConstruction");
+
+		ParallelDeterminization determinization(table, GetLambdaTable(), alphabet, finalStates, threads);
+		determinization.Run(initialSubset);
+		dfa = determinization.BuildDFA();
+	}
+
+	if (canonicalNumbering)
+	{
+		LFA_STATISTICS_PHASE("Renumbering");
+		dfa.RenumberStates(dfa.GetBreadthFirstNumbering());
+	}
+
+	return dfa;
+}
+
+bool NondeterministicFiniteAutomata::WriteDFA(std::ofstream& ofs, String const& directory, uint64 const& memoryLimit) const
+{
+	if (!HasStates() || !HasTransitions())
+	{
+		ToDFA().WriteBinary(ofs);
+		return static_cast<bool>(ofs);
+	}
+
+	// Subsets of states which cannot reach a final state only add dead states to the DFA.
+	Vector<bool> const useful = GetUsefulStates();
+
+	if (std::find(useful.begin(), useful.end(), false) != useful.end())
+	{
+		NondeterministicFiniteAutomata trimmed(*this);
+		trimmed.Trim();
+		return trimmed.WriteDFA(ofs, directory, memoryLimit);
+	}
+
+	LFA_STATISTICS_OPERATION("ToDFAExternal");
+
+	Set<char> const alphabet = GetAlphabet();
+	TransitionTable const& table = GetTransitionTable();
+	Vector<bool> finalStates(table.GetStates(), false);
+	StatesVector initialSubset({ _initialState }), marks(table.GetStates(), TransitionTable::InvalidState);
+
+	for (StatesConstIterator itr = _finalStates->begin(); itr != _finalStates->end(); ++itr)
+		if ((*itr) < finalStates.size())
+			finalStates[*itr] = true;
+
+	marks[_initialState] = 0;
+	GetLambdaTable().AddClosure(Lambda, &initialSubset, &marks, 0);
+
+	ExternalDeterminization determinization(table, GetLambdaTable(), alphabet, finalStates, directory, memoryLimit);
+	return determinization.Run(initialSubset) && determinization.Write(ofs);
+}
+
+StatesSet NondeterministicFiniteAutomata::LambdaClosure(TransitionTable const& lambdaTable, uint32 const& state) const
+{
+	return LambdaClosure(lambdaTable, StatesSet({ state }));
+}
+
+StatesSet NondeterministicFiniteAutomata::LambdaClosure(TransitionTable const& lambdaTable, StatesSet const& states) const
+{
+	if (states.empty())
+		return StatesSet();
+
+	LFA_STATISTICS_ADD(lambdaClosures, 1);
+
+	StatesSet closure(states);
+	Stack<uint32> stack;
+
+	for (StatesSetConstIterator itr = states.begin(); itr != states.end(); ++itr)
+		stack.push(*itr);
+
+	while (!stack.empty())
+	{
+		TargetsRange targets = lambdaTable.Find(stack.top(), Lambda);
+		stack.pop();
+
+		for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+			if (closure.insert(*itr).second)
+				stack.push(*itr);
+	}
+
+	return closure;
+}
+
+StatesSet NondeterministicFiniteAutomata::MoveTo(TransitionTable const& table, StatesSet const& states, char const& key) const
+{
+	StatesSet closure;
+
+	for (StatesSetConstIterator itr = states.begin(); itr != states.end(); ++itr)
+	{
+		TargetsRange targets = table.Find(*itr, key);
+		closure.insert(targets.first, targets.second);
+	}
+
+	return closure;
+}
+
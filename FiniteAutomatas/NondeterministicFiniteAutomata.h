@@ -1,37 +1,71 @@
-#ifndef LFA_LIB_NONDETERMINISTIC_FINITE_AUTOMATA_H
-#define LFA_LIB_NONDETERMINISTIC_FINITE_AUTOMATA_H
-
-#include "PCH.h"
-#include "FiniteAutomata.h"
-#include "DeterministicFiniteAutomata.h"
-
-class NondeterministicFiniteAutomata : public FiniteAutomata
-{
-	public:
-		NondeterministicFiniteAutomata() : FiniteAutomata() { }
-		NondeterministicFiniteAutomata(std::ifstream& ifs);
-		NondeterministicFiniteAutomata(NondeterministicFiniteAutomata const& source) : FiniteAutomata(source) { }
-		NondeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
-			Vector<uint32> const& finalStates, TransitionMap const& transitionFunction) : 
-			FiniteAutomata(states, initialState, finalStates, transitionFunction) { }
-
-		void Reverse() override;
-
-		bool IsAccepted(String const& word) const override;
-
-		String GenerateWord(uint32 const& length) const override;
-
-		DFA ToDFA() const;
-
-	private:
-		StatesSet LambdaClosure(uint32 const& state) const;
-		StatesSet LambdaClosure(StatesSet const& states) const;
-
-		StatesSet MoveTo(uint32 const& state, char const& key) const;
-		StatesSet MoveTo(StatesSet const& states, char const& key) const;
-};
-
-typedef NondeterministicFiniteAutomata NFA;
-
-#endif
-
+#ifndef LFA_LIB_NONDETERMINISTIC_FINITE_AUTOMATA_H
+#define LFA_LIB_NONDETERMINISTIC_FINITE_AUTOMATA_H
+
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "DeterministicFiniteAutomata.h"
+
+class NondeterministicFiniteAutomata : public FiniteAutomata
+{
+	public:
+		NondeterministicFiniteAutomata() : FiniteAutomata() { }
+		NondeterministicFiniteAutomata(std::ifstream& ifs);
+		NondeterministicFiniteAutomata(NondeterministicFiniteAutomata const& source) : FiniteAutomata(source) { }
+		// The transitions on Lambda are the lambda transitions, as in the input files.
+		NondeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			Vector<uint32> const& finalStates, TransitionMap const& transitionFunction);
+		NondeterministicFiniteAutomata(NondeterministicFiniteAutomata&& source) : FiniteAutomata(std::move(source)) { }
+		NondeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			Vector<uint32> const& finalStates, TransitionTable const& transitionTable) : 
+			FiniteAutomata(states, initialState, finalStates, transitionTable) { }
+		NondeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			Vector<uint32>&& finalStates, TransitionTable&& transitionTable) : 
+			FiniteAutomata(states, initialState, std::move(finalStates), std::move(transitionTable)) { }
+		NondeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			Vector<uint32> const& finalStates, TransitionTable const& transitionTable, TransitionTable const& lambdaTable) : 
+			FiniteAutomata(states, initialState, finalStates, transitionTable, lambdaTable) { }
+		NondeterministicFiniteAutomata(uint32 const& states, uint32 const& initialState, 
+			Vector<uint32>&& finalStates, TransitionsVector transitions, TransitionsVector lambdaTransitions) : 
+			FiniteAutomata(states, initialState, std::move(finalStates), std::move(transitions), std::move(lambdaTransitions)) { }
+
+		void Reverse() override;
+
+		bool IsAccepted(String const& word) const override;
+
+		String GenerateWord(uint32 const& length) const override;
+
+		// Lambda transitions are written on Lambda, so an NFA which also reads Lambda is not written.
+		bool Write(std::ofstream& ofs) const override;
+
+		// Removes the lambda transitions, the useless states, merges the states simulating each other
+		// and drops the moves to states simulated by another target of the same move.
+		// The language stays the same and subset construction has fewer states to work with afterwards.
+		void Reduce();
+		NondeterministicFiniteAutomata GetReduced() const;
+
+		DFA ToDFA() const;
+
+		// Subset construction spread over threads workers, 0 uses every hardware thread.
+		// With canonicalNumbering the result is renumbered in breadth-first order and equals ToDFA().
+		DFA ToDFAParallel(uint32 threads = 0, bool canonicalNumbering = true) const;
+
+		// Subset construction for DFAs larger than memory, the subsets are kept in sorted spill files in directory
+		// and about memoryLimit bytes of them are held in memory at once. The DFA is written to ofs, opened with std::ios::binary,
+		// in the format of DFA::WriteBinary. Read back with DFA::ReadBinary it equals ToDFA() up to the numbering of the states.
+		// Returns false if a spill file cannot be written or read, ofs is left incomplete then.
+		bool WriteDFA(std::ofstream& ofs, String const& directory, uint64 const& memoryLimit) const;
+
+		NondeterministicFiniteAutomata& operator=(NondeterministicFiniteAutomata const& source) { FiniteAutomata::operator=(source); return *this; }
+		NondeterministicFiniteAutomata& operator=(NondeterministicFiniteAutomata&& source) { FiniteAutomata::operator=(std::move(source)); return *this; }
+
+	private:
+		StatesSet LambdaClosure(TransitionTable const& lambdaTable, uint32 const& state) const;
+		StatesSet LambdaClosure(TransitionTable const& lambdaTable, StatesSet const& states) const;
+
+		StatesSet MoveTo(TransitionTable const& table, StatesSet const& states, char const& key) const;
+};
+
+typedef NondeterministicFiniteAutomata NFA;
+
+#endif
+
@@ -0,0 +1,164 @@
+#include "PCH.h"
+#include "PatternSet.h"
+#include "Statistics.h"
+
+uint32 const PatternSet::UnknownState = TransitionTable::InvalidState - 1;
+
+uint32 PatternSet::Add(FiniteAutomata const& pattern)
+{
+	uint32 const id = GetPatternsCount();
+	uint32 const offset = static_cast<uint32>(_patterns.size());
+	TransitionTable const& table = pattern.GetTransitionTable();
+	StatesSet const finalStates = pattern.GetFinalStates();
+	uint32 const states = std::max(table.GetStates(), pattern.GetStatesCount());
+
+	auto append = [offset](TransitionTable const& edges, TransitionsVector* transitions)
+	{
+		for (uint32 state = 0; state < edges.GetStates(); ++state)
+			for (uint32 edge = edges.GetEdgesBegin(state); edge < edges.GetEdgesEnd(state); ++edge)
+			{
+				TargetsRange targets = edges.GetTargets(edge);
+
+				for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+					transitions->emplace_back(TransitionPair(offset + state, edges.GetSymbol(edge)), offset + (*itr));
+			}
+	};
+
+	append(table, &_transitions);
+	append(pattern.GetLambdaTable(), &_lambdaTransitions);
+
+	_patterns.resize(offset + states, id);
+	_finalStates.resize(offset + states, false);
+
+	for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		if ((*itr) < states)
+			_finalStates[offset + (*itr)] = true;
+
+	if (pattern.HasStates())
+		_initialStates.push_back(offset + pattern.GetInitialState());
+	else
+		_initialStates.push_back(TransitionTable::InvalidState);
+
+	// The union DFA built so far belongs to the previous patterns.
+	_subsetsIndex.clear();
+	_subsets.clear();
+
+	return id;
+}
+
+void PatternSet::Compile()
+{
+	LFA_STATISTICS_OPERATION("PatternSet::Compile");
+
+	if (_subsets.empty())
+		Build();
+
+	for (uint32 i = 0; i < _subsets.size(); ++i)
+		for (Set<char>::const_iterator key = _alphabet.begin(); key != _alphabet.end(); ++key)
+			if (_next[i * 256 + static_cast<uint8>(*key)] == UnknownState)
+				Expand(i, *key);
+}
+
+Vector<uint32> PatternSet::Match(String const& word)
+{
+	if (_subsets.empty())
+		Build();
+
+	uint32 state = 0;
+
+	for (String::const_iterator itr = word.begin(); itr != word.end(); ++itr)
+	{
+		uint32 next = _next[state * 256 + static_cast<uint8>(*itr)];
+
+		if (next == UnknownState)
+			next = Expand(state, *itr);
+
+		if (next == TransitionTable::InvalidState)
+			return Vector<uint32>();
+
+		state = next;
+	}
+
+	return _acceptingPatterns[state];
+}
+
+void PatternSet::Build()
+{
+	_table = TransitionTable(static_cast<uint32>(_patterns.size()), _transitions);
+	_lambdaTable = TransitionTable(static_cast<uint32>(_patterns.size()), _lambdaTransitions);
+	_marks.assign(_table.GetStates(), TransitionTable::InvalidState);
+	_stamp = 0;
+
+	_alphabet.clear();
+	_acceptingPatterns.clear();
+	_next.clear();
+
+	for (uint32 edge = 0; edge < _table.GetEdgesCount(); ++edge)
+		_alphabet.insert(_table.GetSymbol(edge));
+
+	// The union DFA starts in the lambda closure of every initial state.
+	++_stamp;
+	_subset.clear();
+
+	for (StatesConstIterator itr = _initialStates.begin(); itr != _initialStates.end(); ++itr)
+		if ((*itr) != TransitionTable::InvalidState && _marks[*itr] != _stamp)
+		{
+			_marks[*itr] = _stamp;
+			_subset.push_back(*itr);
+		}
+
+	_lambdaTable.AddClosure(FiniteAutomata::Lambda, &_subset, &_marks, _stamp);
+	GetState(_subset);
+}
+
+uint32 PatternSet::GetState(StatesVector const& subset)
+{
+	Map<StatesVector, uint32>::const_iterator itr = _subsetsIndex.find(subset);
+
+	if (itr != _subsetsIndex.end())
+		return itr->second;
+
+	uint32 const state = static_cast<uint32>(_subsets.size());
+	Vector<uint32> acceptingPatterns;
+
+	itr = _subsetsIndex.emplace(subset, state).first;
+	_subsets.push_back(&itr->first);
+
+	for (StatesConstIterator iter = subset.begin(); iter != subset.end(); ++iter)
+		if (_finalStates[*iter])
+			acceptingPatterns.push_back(_patterns[*iter]);
+
+	// Union states are grouped by pattern, so equal ids are adjacent.
+	acceptingPatterns.erase(std::unique(acceptingPatterns.begin(), acceptingPatterns.end()), acceptingPatterns.end());
+	_acceptingPatterns.push_back(std::move(acceptingPatterns));
+
+	// Symbols outside the alphabet lead nowhere.
+	_next.resize(_next.size() + 256, TransitionTable::InvalidState);
+
+	for (Set<char>::const_iterator key = _alphabet.begin(); key != _alphabet.end(); ++key)
+		_next[state * 256 + static_cast<uint8>(*key)] = UnknownState;
+
+	return state;
+}
+
+uint32 PatternSet::Expand(uint32 const& state, char const& key)
+{
+	LFA_STATISTICS_ADD(subsetsExplored, 1);
+
+	++_stamp;
+	_subset.clear();
+	_table.AddTargets(*_subsets[state], key, &_subset, &_marks, _stamp);
+
+	uint32 next = TransitionTable::InvalidState;
+
+	if (!_subset.empty())
+	{
+		_lambdaTable.AddClosure(FiniteAutomata::Lambda, &_subset, &_marks, _stamp);
+		next = GetState(_subset);
+	}
+
+	_next[state * 256 + static_cast<uint8>(key)] = next;
+
+	return next;
+}
+
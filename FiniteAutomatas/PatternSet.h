@@ -0,0 +1,57 @@
+#ifndef LFA_LIB_PATTERN_SET_H
+#define LFA_LIB_PATTERN_SET_H
+
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "TransitionTable.h"
+
+// Matches a word against many automata in one pass.
+// The patterns are joined in a union NFA which is determinized lazily while matching:
+// a state of the union DFA is built the first time a word reaches it and remembers
+// the ids of the patterns accepting in it. Compile builds the whole union DFA up front.
+class PatternSet
+{
+	public:
+		PatternSet() : _stamp(0) { }
+
+		// Returns the id of the pattern, ids are given in order starting from 0.
+		uint32 Add(FiniteAutomata const& pattern);
+
+		uint32 GetPatternsCount() const { return static_cast<uint32>(_initialStates.size()); }
+		uint32 GetBuiltStatesCount() const { return static_cast<uint32>(_subsets.size()); }
+
+		void Compile();
+
+		// Ids of the patterns accepting word, in increasing order.
+		Vector<uint32> Match(String const& word);
+
+	private:
+		static uint32 const UnknownState;	// Transition not built yet.
+
+		// Union NFA, the states of every pattern are offset by the states of the patterns before it.
+		// Lambda transitions are kept apart, as in the patterns, so every symbol stands for itself.
+		TransitionsVector _transitions;
+		TransitionsVector _lambdaTransitions;
+		StatesVector _initialStates;
+		StatesVector _patterns;			// Pattern of every union state.
+		Vector<bool> _finalStates;
+		TransitionTable _table;
+		TransitionTable _lambdaTable;
+
+		// Union DFA
+		Map<StatesVector, uint32> _subsetsIndex;
+		Vector<StatesVector const*> _subsets;
+		Vector<Vector<uint32>> _acceptingPatterns;
+		StatesVector _next;				// 256 transitions per state.
+		Set<char> _alphabet;
+
+		StatesVector _subset, _marks;
+		uint32 _stamp;
+
+		void Build();
+		uint32 GetState(StatesVector const& subset);
+		uint32 Expand(uint32 const& state, char const& key);
+};
+
+#endif
+
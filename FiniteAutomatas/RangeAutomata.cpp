@@ -0,0 +1,573 @@
+#include "PCH.h"
+#include "RangeAutomata.h"
+#include "TransitionTable.h"
+#include "Statistics.h"
+
+namespace
+{
+	typedef Vector<Pair<uint8, uint8>> Utf8Sequence;	// One byte range per byte of the encoding.
+
+	uint32 EncodeUtf8(uint32 const& codePoint, uint8* bytes)
+	{
+		if (codePoint < 0x80)
+		{
+			bytes[0] = static_cast<uint8>(codePoint);
+			return 1;
+		}
+
+		if (codePoint < 0x800)
+		{
+			bytes[0] = static_cast<uint8>(0xC0 | (codePoint >> 6));
+			bytes[1] = static_cast<uint8>(0x80 | (codePoint & 0x3F));
+			return 2;
+		}
+
+		if (codePoint < 0x10000)
+		{
+			bytes[0] = static_cast<uint8>(0xE0 | (codePoint >> 12));
+			bytes[1] = static_cast<uint8>(0x80 | ((codePoint >> 6) & 0x3F));
+			bytes[2] = static_cast<uint8>(0x80 | (codePoint & 0x3F));
+			return 3;
+		}
+
+		bytes[0] = static_cast<uint8>(0xF0 | (codePoint >> 18));
+		bytes[1] = static_cast<uint8>(0x80 | ((codePoint >> 12) & 0x3F));
+		bytes[2] = static_cast<uint8>(0x80 | ((codePoint >> 6) & 0x3F));
+		bytes[3] = static_cast<uint8>(0x80 | (codePoint & 0x3F));
+		return 4;
+	}
+
+	// Splits [first, last] in ranges whose encodings are exactly the byte sequences matching
+	// a fixed list of byte ranges. Ranges are split where the encoded length changes, then
+	// until every continuation byte below the first differing one spans all of 0x80 to 0xBF.
+	void SplitUtf8(uint32 const& first, uint32 const& last, Vector<Utf8Sequence>* sequences)
+	{
+		Stack<Pair<uint32, uint32>> ranges;
+
+		// Surrogates have no encoding.
+		if (last >= 0xE000)
+			ranges.push(std::make_pair(std::max<uint32>(first, 0xE000), last));
+
+		if (first < 0xD800)
+			ranges.push(std::make_pair(first, std::min<uint32>(last, 0xD7FF)));
+
+		while (!ranges.empty())
+		{
+			uint32 start = ranges.top().first;
+			uint32 end = ranges.top().second;
+			bool split = false;
+
+			ranges.pop();
+
+			uint32 const lengthBoundaries[] = { 0x7F, 0x7FF, 0xFFFF };
+
+			for (uint32 i = 0; i < 3 && !split; ++i)
+				if (start <= lengthBoundaries[i] && lengthBoundaries[i] < end)
+				{
+					ranges.push(std::make_pair(lengthBoundaries[i] + 1, end));
+					ranges.push(std::make_pair(start, lengthBoundaries[i]));
+					split = true;
+				}
+
+			if (split)
+				continue;
+
+			if (end <= 0x7F)
+			{
+				sequences->push_back(Utf8Sequence(1, std::make_pair(static_cast<uint8>(start), static_cast<uint8>(end))));
+				continue;
+			}
+
+			for (uint32 i = 1; i < 4 && !split; ++i)
+			{
+				uint32 mask = (1u << (6 * i)) - 1;
+
+				if ((start & ~mask) == (end & ~mask))
+					continue;
+
+				if ((start & mask) != 0)
+				{
+					ranges.push(std::make_pair((start | mask) + 1, end));
+					ranges.push(std::make_pair(start, start | mask));
+					split = true;
+				}
+				else if ((end & mask) != mask)
+				{
+					ranges.push(std::make_pair(end & ~mask, end));
+					ranges.push(std::make_pair(start, (end & ~mask) - 1));
+					split = true;
+				}
+			}
+
+			if (split)
+				continue;
+
+			uint8 startBytes[4], endBytes[4];
+			uint32 length = EncodeUtf8(start, startBytes);
+			Utf8Sequence sequence;
+
+			EncodeUtf8(end, endBytes);
+
+			for (uint32 i = 0; i < length; ++i)
+				sequence.emplace_back(startBytes[i], endBytes[i]);
+
+			sequences->push_back(std::move(sequence));
+		}
+	}
+}
+
+uint32 const RangeAutomata::MaximumCodePoint;
+
+RangeAutomata::RangeAutomata(FiniteAutomata const& automaton) : _initialState(0)
+{
+	if (!automaton.HasStates())
+		return;
+
+	TransitionTable const& table = automaton.GetTransitionTable();
+	TransitionTable const& lambdaTable = automaton.GetLambdaTable();
+	StatesSet const finalStates = automaton.GetFinalStates();
+
+	for (uint32 state = 0; state < std::max(table.GetStates(), automaton.GetStatesCount()); ++state)
+		AddState(finalStates.find(state) != finalStates.end());
+
+	_initialState = automaton.GetInitialState();
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+		{
+			char const key = table.GetSymbol(edge);
+			TargetsRange targets = table.GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				AddTransition(state, static_cast<uint8>(key), static_cast<uint8>(key), *itr);
+		}
+
+	for (uint32 state = 0; state < lambdaTable.GetStates(); ++state)
+	{
+		TargetsRange targets = lambdaTable.Find(state, FiniteAutomata::Lambda);
+
+		for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+			AddLambdaTransition(state, *itr);
+	}
+}
+
+uint32 RangeAutomata::AddState(bool final)
+{
+	_finalStates.push_back(final);
+	_transitions.emplace_back();
+	_lambdaTransitions.emplace_back();
+
+	return GetStatesCount() - 1;
+}
+
+void RangeAutomata::AddTransition(uint32 const& state, uint32 const& first, uint32 const& last, uint32 const& target)
+{
+	assert(state < GetStatesCount() && target < GetStatesCount() && first <= last && last <= MaximumCodePoint);
+
+	_transitions[state].emplace_back(first, last, target);
+}
+
+void RangeAutomata::AddLambdaTransition(uint32 const& state, uint32 const& target)
+{
+	assert(state < GetStatesCount() && target < GetStatesCount());
+
+	_lambdaTransitions[state].push_back(target);
+}
+
+bool RangeAutomata::IsDeterministic() const
+{
+	for (uint32 state = 0; state < GetStatesCount(); ++state)
+	{
+		if (!_lambdaTransitions[state].empty())
+			return false;
+
+		Vector<Pair<uint32, uint32>> ranges;
+
+		for (RangeTransitionsVector::const_iterator itr = _transitions[state].begin(); itr != _transitions[state].end(); ++itr)
+			ranges.emplace_back(itr->first, itr->last);
+
+		std::sort(ranges.begin(), ranges.end());
+
+		for (uint32 i = 1; i < ranges.size(); ++i)
+			if (ranges[i].first <= ranges[i - 1].second)
+				return false;
+	}
+
+	return true;
+}
+
+bool RangeAutomata::IsAccepted(CodePointsVector const& word) const
+{
+	if (!HasStates())
+		return false;
+
+	uint32 stamp = 0;
+	StatesVector current(1, _initialState), next, marks(GetStatesCount(), TransitionTable::InvalidState);
+
+	marks[_initialState] = stamp;
+	LambdaClosure(&current, &marks, stamp);
+
+	for (CodePointsVector::const_iterator itr = word.begin(); itr != word.end(); ++itr)
+	{
+		++stamp;
+		next.clear();
+
+		for (StatesConstIterator state = current.begin(); state != current.end(); ++state)
+			for (RangeTransitionsVector::const_iterator iter = _transitions[*state].begin(); iter != _transitions[*state].end(); ++iter)
+				if (iter->first <= (*itr) && (*itr) <= iter->last && marks[iter->target] != stamp)
+				{
+					marks[iter->target] = stamp;
+					next.push_back(iter->target);
+				}
+
+		if (next.empty())
+			return false;
+
+		LambdaClosure(&next, &marks, stamp);
+		current.swap(next);
+	}
+
+	for (StatesConstIterator state = current.begin(); state != current.end(); ++state)
+		if (_finalStates[*state])
+			return true;
+
+	return false;
+}
+
+bool RangeAutomata::IsAccepted(String const& word) const
+{
+	CodePointsVector codePoints;
+
+	return DecodeUtf8(word, &codePoints) && IsAccepted(codePoints);
+}
+
+RangeAutomata RangeAutomata::ToDFA() const
+{
+	if (!HasStates())
+		return RangeAutomata();
+
+	LFA_STATISTICS_OPERATION("RangeAutomata::ToDFA");
+
+	return Determinize(StatesVector(1, _initialState));
+}
+
+RangeAutomata RangeAutomata::GetMinimal() const
+{
+	if (!HasStates())
+		return RangeAutomata();
+
+	LFA_STATISTICS_OPERATION("RangeAutomata::GetMinimal");
+
+	// Both reversals start from the set of final states, a new initial state would be
+	// part of the first subset and keep it apart from an equivalent one.
+	RangeAutomata dfa = GetReversedTransitions().Determinize(GetFinalStates());
+
+	return dfa.GetReversedTransitions().Determinize(dfa.GetFinalStates());
+}
+
+RangeAutomata RangeAutomata::GetReverse() const
+{
+	if (!HasStates())
+		return RangeAutomata();
+
+	// A new initial state leads by lambda to the old final states.
+	RangeAutomata reverse = GetReversedTransitions();
+	StatesVector const finalStates = GetFinalStates();
+
+	reverse.SetInitialState(reverse.AddState());
+
+	for (StatesConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		reverse.AddLambdaTransition(reverse.GetInitialState(), *itr);
+
+	return reverse;
+}
+
+StatesVector RangeAutomata::GetFinalStates() const
+{
+	StatesVector finalStates;
+
+	for (uint32 state = 0; state < GetStatesCount(); ++state)
+		if (_finalStates[state])
+			finalStates.push_back(state);
+
+	return finalStates;
+}
+
+RangeAutomata RangeAutomata::Determinize(StatesVector startStates) const
+{
+	RangeAutomata dfa;
+	uint32 stamp = 0;
+	StatesVector subset, marks(GetStatesCount(), TransitionTable::InvalidState);
+	Map<StatesVector, uint32> subsetsIndex;
+	Vector<StatesVector const*> subsets;
+
+	// (code point, (opens, target)), a transition opens at first and closes at last + 1.
+	Vector<Pair<uint32, Pair<bool, uint32>>> events;
+	Map<uint32, uint32> active;	// Targets of the transitions covering the current interval, with their count.
+
+	for (StatesConstIterator itr = startStates.begin(); itr != startStates.end(); ++itr)
+		if (marks[*itr] != stamp)
+		{
+			marks[*itr] = stamp;
+			subset.push_back(*itr);
+		}
+
+	LambdaClosure(&subset, &marks, stamp);
+	subsets.push_back(&subsetsIndex.emplace(subset, dfa.AddState()).first->first);
+
+	for (uint32 i = 0; i < subsets.size(); ++i)
+	{
+		StatesVector const& current = *subsets[i];
+
+		LFA_STATISTICS_ADD(subsetsExplored, 1);
+		LFA_STATISTICS_ADD(subsetsStates, current.size());
+
+		events.clear();
+
+		for (StatesConstIterator state = current.begin(); state != current.end(); ++state)
+		{
+			if (_finalStates[*state])
+				dfa.SetFinalState(i);
+
+			for (RangeTransitionsVector::const_iterator itr = _transitions[*state].begin(); itr != _transitions[*state].end(); ++itr)
+			{
+				events.push_back(std::make_pair(itr->first, std::make_pair(true, itr->target)));
+				events.push_back(std::make_pair(itr->last + 1, std::make_pair(false, itr->target)));
+			}
+		}
+
+		std::sort(events.begin(), events.end());
+
+		// Sweep the elementary intervals, between two consecutive event points the targets do not change.
+		for (uint32 j = 0; j < events.size(); )
+		{
+			uint32 const first = events[j].first;
+
+			for (; j < events.size() && events[j].first == first; ++j)
+				if (events[j].second.first)
+					++active[events[j].second.second];
+				else if (--active[events[j].second.second] == 0)
+					active.erase(events[j].second.second);
+
+			if (active.empty())
+				continue;
+
+			++stamp;
+			subset.clear();
+
+			for (Map<uint32, uint32>::const_iterator itr = active.begin(); itr != active.end(); ++itr)
+			{
+				marks[itr->first] = stamp;
+				subset.push_back(itr->first);
+			}
+
+			LambdaClosure(&subset, &marks, stamp);
+
+			Map<StatesVector, uint32>::const_iterator itr = subsetsIndex.find(subset);
+
+			if (itr == subsetsIndex.end())
+			{
+				itr = subsetsIndex.emplace(subset, dfa.AddState()).first;
+				subsets.push_back(&itr->first);
+			}
+
+			RangeTransitionsVector& transitions = dfa._transitions[i];
+			uint32 const last = events[j].first - 1;
+
+			if (!transitions.empty() && transitions.back().target == itr->second && transitions.back().last + 1 == first)
+				transitions.back().last = last;
+			else
+				transitions.emplace_back(first, last, itr->second);
+		}
+	}
+
+	return dfa;
+}
+
+DFA RangeAutomata::ToUtf8DFA() const
+{
+	if (!HasStates())
+		return DFA();
+
+	LFA_STATISTICS_OPERATION("RangeAutomata::ToUtf8DFA");
+
+	// Minimizing first keeps the byte automaton small, each range turns into a few byte chains.
+	RangeAutomata const minimal = GetMinimal();
+	uint32 states = minimal.GetStatesCount();
+	TransitionsVector transitions;
+	Vector<Utf8Sequence> sequences;
+
+	for (uint32 state = 0; state < minimal.GetStatesCount(); ++state)
+		for (RangeTransitionsVector::const_iterator itr = minimal._transitions[state].begin(); itr != minimal._transitions[state].end(); ++itr)
+		{
+			sequences.clear();
+			SplitUtf8(itr->first, itr->last, &sequences);
+
+			for (Vector<Utf8Sequence>::const_iterator sequence = sequences.begin(); sequence != sequences.end(); ++sequence)
+			{
+				uint32 current = state;
+
+				for (uint32 i = 0; i < sequence->size(); ++i)
+				{
+					uint32 next = (i + 1 == sequence->size()) ? itr->target : states++;
+
+					for (uint32 byte = (*sequence)[i].first; byte <= (*sequence)[i].second; ++byte)
+						transitions.emplace_back(TransitionPair(current, static_cast<char>(byte)), next);
+
+					current = next;
+				}
+			}
+		}
+
+	// Sequences leaving a state may share their leading bytes, so the byte automaton is determinized.
+	// It has no lambda transitions, so subsets need no closure.
+	TransitionTable const table(states, std::move(transitions));
+	Set<char> alphabet;
+
+	for (uint32 edge = 0; edge < table.GetEdgesCount(); ++edge)
+		alphabet.insert(table.GetSymbol(edge));
+
+	uint32 stamp = 0;
+	StatesVector subset, marks(table.GetStates(), TransitionTable::InvalidState), finalStates;
+	Map<StatesVector, uint32> subsetsIndex;
+	Vector<StatesVector const*> subsets;
+	TransitionsVector dfaTransitions;
+
+	subsets.push_back(&subsetsIndex.emplace(StatesVector(1, minimal.GetInitialState()), 0).first->first);
+
+	for (uint32 i = 0; i < subsets.size(); ++i)
+	{
+		StatesVector const& current = *subsets[i];
+
+		for (StatesConstIterator state = current.begin(); state != current.end(); ++state)
+			if ((*state) < minimal.GetStatesCount() && minimal.IsFinalState(*state))
+			{
+				finalStates.push_back(i);
+				break;
+			}
+
+		for (Set<char>::const_iterator key = alphabet.begin(); key != alphabet.end(); ++key)
+		{
+			++stamp;
+			subset.clear();
+			table.AddTargets(current, *key, &subset, &marks, stamp);
+
+			if (subset.empty())
+				continue;
+
+			std::sort(subset.begin(), subset.end());
+
+			Map<StatesVector, uint32>::const_iterator itr = subsetsIndex.find(subset);
+
+			if (itr == subsetsIndex.end())
+			{
+				itr = subsetsIndex.emplace(subset, static_cast<uint32>(subsets.size())).first;
+				subsets.push_back(&itr->first);
+			}
+
+			dfaTransitions.emplace_back(TransitionPair(i, *key), itr->second);
+		}
+	}
+
+	uint32 const dfaStates = static_cast<uint32>(subsets.size());
+
+	return DFA(dfaStates, 0, std::move(finalStates), TransitionTable(dfaStates, std::move(dfaTransitions))).GetMinimalDFA();
+}
+
+bool RangeAutomata::DecodeUtf8(String const& word, CodePointsVector* codePoints)
+{
+	codePoints->clear();
+
+	for (uint32 i = 0; i < word.size(); )
+	{
+		uint8 byte = static_cast<uint8>(word[i]);
+		uint32 codePoint, length, minimum;
+
+		if (byte < 0x80)
+		{
+			codePoint = byte;
+			length = 1;
+			minimum = 0;
+		}
+		else if ((byte & 0xE0) == 0xC0)
+		{
+			codePoint = byte & 0x1F;
+			length = 2;
+			minimum = 0x80;
+		}
+		else if ((byte & 0xF0) == 0xE0)
+		{
+			codePoint = byte & 0x0F;
+			length = 3;
+			minimum = 0x800;
+		}
+		else if ((byte & 0xF8) == 0xF0)
+		{
+			codePoint = byte & 0x07;
+			length = 4;
+			minimum = 0x10000;
+		}
+		else
+			return false;
+
+		if (i + length > word.size())
+			return false;
+
+		for (uint32 j = 1; j < length; ++j)
+		{
+			byte = static_cast<uint8>(word[i + j]);
+
+			if ((byte & 0xC0) != 0x80)
+				return false;
+
+			codePoint = (codePoint << 6) | (byte & 0x3F);
+		}
+
+		// Overlong encodings, surrogates and code points past the last one are malformed.
+		if (codePoint < minimum || codePoint > MaximumCodePoint || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+			return false;
+
+		codePoints->push_back(codePoint);
+		i += length;
+	}
+
+	return true;
+}
+
+RangeAutomata RangeAutomata::GetReversedTransitions() const
+{
+	RangeAutomata reverse;
+
+	// The old initial state is the only final state.
+	for (uint32 state = 0; state < GetStatesCount(); ++state)
+		reverse.AddState(state == _initialState);
+
+	for (uint32 state = 0; state < GetStatesCount(); ++state)
+	{
+		for (RangeTransitionsVector::const_iterator itr = _transitions[state].begin(); itr != _transitions[state].end(); ++itr)
+			reverse.AddTransition(itr->target, itr->first, itr->last, state);
+
+		for (StatesConstIterator itr = _lambdaTransitions[state].begin(); itr != _lambdaTransitions[state].end(); ++itr)
+			reverse.AddLambdaTransition(*itr, state);
+	}
+
+	return reverse;
+}
+
+void RangeAutomata::LambdaClosure(StatesVector* states, StatesVector* marks, uint32 const& stamp) const
+{
+	for (uint32 i = 0; i < states->size(); ++i)
+	{
+		StatesVector const& targets = _lambdaTransitions[(*states)[i]];
+
+		for (StatesConstIterator itr = targets.begin(); itr != targets.end(); ++itr)
+			if ((*marks)[*itr] != stamp)
+			{
+				(*marks)[*itr] = stamp;
+				states->push_back(*itr);
+			}
+	}
+
+	std::sort(states->begin(), states->end());
+}
+
@@ -0,0 +1,86 @@
+#ifndef LFA_LIB_RANGE_AUTOMATA_H
+#define LFA_LIB_RANGE_AUTOMATA_H
+
+#include "PCH.h"
+#include "FiniteAutomata.h"
+#include "DeterministicFiniteAutomata.h"
+
+typedef Vector<uint32> CodePointsVector;
+
+struct RangeTransition
+{
+	uint32 first;	// The transition is taken on the code points in [first, last].
+	uint32 last;
+	uint32 target;
+
+	RangeTransition(uint32 const& first, uint32 const& last, uint32 const& target) : first(first), last(last), target(target) { }
+};
+
+typedef Vector<RangeTransition> RangeTransitionsVector;
+
+// Automaton over Unicode code points with transitions labeled by code point intervals,
+// so a class like [^a] is a couple of edges instead of a million. Lambda transitions are
+// kept apart from the labeled ones, so no code point stands for lambda.
+// ToDFA runs the subset construction over the intervals the edges of a subset split the code points in,
+// which keeps ToDFA and GetMinimal proportional to the edges instead of the alphabet.
+// ToUtf8DFA compiles the automaton to a byte DFA matching the UTF-8 encoding of the accepted words.
+class RangeAutomata
+{
+	public:
+		static uint32 const MaximumCodePoint = 0x10FFFF;
+
+		RangeAutomata() : _initialState(0) { }
+		explicit RangeAutomata(FiniteAutomata const& automaton);	// Every symbol is read as a code point up to 255.
+
+		uint32 AddState(bool final = false);
+		void SetInitialState(uint32 const& state) { assert(state < GetStatesCount()); _initialState = state; }
+		void SetFinalState(uint32 const& state, bool final = true) { assert(state < GetStatesCount()); _finalStates[state] = final; }
+		void AddTransition(uint32 const& state, uint32 const& first, uint32 const& last, uint32 const& target);
+		void AddLambdaTransition(uint32 const& state, uint32 const& target);
+
+		uint32 GetStatesCount() const { return static_cast<uint32>(_finalStates.size()); }
+		uint32 GetInitialState() const { return _initialState; }
+		bool HasStates() const { return !_finalStates.empty(); }
+		bool IsFinalState(uint32 const& state) const { return _finalStates[state]; }
+		StatesVector GetFinalStates() const;
+
+		RangeTransitionsVector const& GetTransitions(uint32 const& state) const { return _transitions[state]; }
+		StatesVector const& GetLambdaTransitions(uint32 const& state) const { return _lambdaTransitions[state]; }
+
+		// No lambda transitions and the ranges of every state are disjoint.
+		bool IsDeterministic() const;
+
+		bool IsAccepted(CodePointsVector const& word) const;
+		bool IsAccepted(String const& word) const;	// word is UTF-8, malformed words are rejected.
+
+		// Only reachable states are kept. Ranges come sorted and adjacent ones with the same target are merged.
+		RangeAutomata ToDFA() const;
+
+		// The minimal deterministic automaton, built with Brzozowski's algorithm.
+		RangeAutomata GetMinimal() const;
+
+		RangeAutomata GetReverse() const;
+
+		// Minimal byte DFA accepting the UTF-8 encodings of the accepted words. Surrogates are skipped,
+		// they have no valid encoding.
+		DFA ToUtf8DFA() const;
+
+		static bool DecodeUtf8(String const& word, CodePointsVector* codePoints);
+
+	private:
+		uint32 _initialState;
+		Vector<bool> _finalStates;
+		Vector<RangeTransitionsVector> _transitions;
+		Vector<StatesVector> _lambdaTransitions;
+
+		// Subset construction starting in the lambda closure of startStates.
+		RangeAutomata Determinize(StatesVector startStates) const;
+
+		// Same states with every transition reversed, the old initial state is the only final state.
+		RangeAutomata GetReversedTransitions() const;
+
+		void LambdaClosure(StatesVector* states, StatesVector* marks, uint32 const& stamp) const;	// Sorts states.
+};
+
+#endif
+
@@ -1,40 +1,66 @@
-#include "PCH.h"
-#include "RegularExpression.h"
-
-bool RegularExpression::IsInParentheses(String const& regularExpression)
-{
-	return ((*regularExpression.begin() == '(') && (*regularExpression.rbegin() == ')'));
-}
-
-String& RegularExpression::Parenthesize(String* regex)
-{
-	regex->insert(regex->begin(), '(');
-	regex->insert(regex->end(), ')');
-	
-	return *regex;
-}
-
-String& RegularExpression::Star(String* regex)
-{
-	regex->insert(regex->end(), '*');
-
-	return *regex;
-}
-
-String RegularExpression::Parenthesize(String const& regex)
-{
-	String res = regex;
-	res.insert(res.begin(), '(');
-	res.insert(res.end(), ')');
-
-	return res;
-}
-
-String RegularExpression::Star(String const& regex)
-{
-	String res = regex;
-	res.insert(res.end(), '*');
-
-	return res;
-}
-
+#include "PCH.h"
+#include "RegularExpression.h"
+
+char const* const RegularExpression::EmptyWord = "()";
+
+bool RegularExpression::IsInParentheses(String const& regularExpression)
+{
+	return ((*regularExpression.begin() == '(') && (*regularExpression.rbegin() == ')'));
+}
+
+String& RegularExpression::Parenthesize(String* regex)
+{
+	regex->insert(regex->begin(), '(');
+	regex->insert(regex->end(), ')');
+	
+	return *regex;
+}
+
+String& RegularExpression::Star(String* regex)
+{
+	regex->insert(regex->end(), '*');
+
+	return *regex;
+}
+
+String RegularExpression::Parenthesize(String const& regex)
+{
+	String res = regex;
+	res.insert(res.begin(), '(');
+	res.insert(res.end(), ')');
+
+	return res;
+}
+
+String RegularExpression::Star(String const& regex)
+{
+	String res = regex;
+	res.insert(res.end(), '*');
+
+	return res;
+}
+
+String RegularExpression::Union(String const& first, String const& second)
+{
+	if (first.empty())
+		return second;
+
+	if (second.empty())
+		return first;
+
+	return "(" + first + "+" + second + ")";
+}
+
+RegularExpression::Term RegularExpression::Union(Term const& first, Term const& second)
+{
+	return Term(Union(first.expression, second.expression), first.emptyWord || second.emptyWord);
+}
+
+String RegularExpression::ToString(Term const& term)
+{
+	if (!term.emptyWord)
+		return term.expression;
+
+	return Union(EmptyWord, term.expression);
+}
+
@@ -1,18 +1,39 @@
-#ifndef LFA_LIB_REGULAR_EXPRESSION_H
-#define LFA_LIB_REGULAR_EXPRESSION_H
-
-#include "PCH.h"
-
-namespace RegularExpression
-{
-	bool IsInParentheses(String const& regularExpression);
-
-	String& Parenthesize(String* regex);
-	String Parenthesize(String const& regex);
-
-	String& Star(String* regex);
-	String Star(String const& regex);
-}
-
-#endif
-
+#ifndef LFA_LIB_REGULAR_EXPRESSION_H
+#define LFA_LIB_REGULAR_EXPRESSION_H
+
+#include "PCH.h"
+
+namespace RegularExpression
+{
+	// Written for the empty word, only where no expression made of symbols can stand for it.
+	extern char const* const EmptyWord;
+
+	// Matches the words of expression and the empty word if emptyWord is set. Keeping the empty word
+	// apart lets every symbol, FiniteAutomata::Lambda included, stand for itself in expression.
+	struct Term
+	{
+		String expression;
+		bool emptyWord;
+
+		Term() : emptyWord(false) { }
+		Term(String const& expression, bool const& emptyWord) : expression(expression), emptyWord(emptyWord) { }
+
+		bool IsEmpty() const { return expression.empty() && !emptyWord; }	// Matches nothing.
+	};
+
+	bool IsInParentheses(String const& regularExpression);
+
+	String& Parenthesize(String* regex);
+	String Parenthesize(String const& regex);
+
+	String& Star(String* regex);
+	String Star(String const& regex);
+
+	String Union(String const& first, String const& second);	// An empty operand matches nothing.
+	Term Union(Term const& first, Term const& second);
+
+	String ToString(Term const& term);
+}
+
+#endif
+
@@ -0,0 +1,235 @@
+#include "PCH.h"
+#include "Searcher.h"
+#include "TransitionTable.h"
+
+namespace
+{
+	// Bytes memchr looks ahead for each of the PREFILTER_BYTES bytes before the nearest one is taken,
+	// so a frequent byte does not make the scans for the other bytes run to the end of the text every time.
+	uint64 const ScanBlockSize = 1 << 12;
+
+	// Same states, only the transitions between states reachable from the initial state
+	// that reach a final state are kept.
+	DFA GetLiveDFA(DFA const& dfa)
+	{
+		if (!dfa.HasStates())
+			return DFA();
+
+		TransitionTable const& table = dfa.GetTransitionTable();
+		StatesSet const finalStates = dfa.GetFinalStates();
+		Vector<bool> finals(table.GetStates(), false);
+		StatesVector liveFinalStates;
+
+		for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+			if ((*itr) < table.GetStates())
+				finals[*itr] = true;
+
+		Vector<bool> const live = table.GetUsefulStates(dfa.GetInitialState(), finals);
+
+		for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+			if ((*itr) < table.GetStates() && live[*itr])
+				liveFinalStates.push_back(*itr);
+
+		TransitionsVector transitions;
+
+		for (uint32 state = 0; state < table.GetStates(); ++state)
+			if (live[state])
+				for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+				{
+					uint32 target = *table.GetTargets(edge).first;
+
+					if (live[target])
+						transitions.emplace_back(TransitionPair(state, table.GetSymbol(edge)), target);
+				}
+
+		return DFA(dfa.GetStatesCount(), dfa.GetInitialState(), std::move(liveFinalStates),
+			TransitionTable(dfa.GetStatesCount(), std::move(transitions)));
+	}
+}
+
+Prefilter::Prefilter(DFA const& dfa) : _kind(PREFILTER_NONE), _canMatch(false)
+{
+	std::fill(_startSet, _startSet + 256, false);
+
+	DFA const live = GetLiveDFA(dfa);
+
+	if (!live.HasFinalStates())
+		return;
+
+	_canMatch = true;
+
+	TransitionTable const& table = live.GetTransitionTable();
+	StatesSet const finalStates = live.GetFinalStates();
+	uint32 state = live.GetInitialState();
+
+	if (finalStates.count(state))
+		return;
+
+	for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+	{
+		_startBytes.push_back(table.GetSymbol(edge));
+		_startSet[static_cast<uint8>(table.GetSymbol(edge))] = true;
+	}
+
+	// Every live state can reach a final one, so a chain of single edges through non final states ends.
+	while (!finalStates.count(state) && table.GetEdgesEnd(state) - table.GetEdgesBegin(state) == 1)
+	{
+		_prefix.push_back(table.GetSymbol(table.GetEdgesBegin(state)));
+		state = *table.GetTargets(table.GetEdgesBegin(state)).first;
+	}
+
+	if (_prefix.size() >= 2)
+		_kind = PREFILTER_PREFIX;
+	else if (_startBytes.size() <= 3)
+		_kind = PREFILTER_BYTES;
+	else if (_startBytes.size() < 256)
+		_kind = PREFILTER_BYTE_SET;
+}
+
+uint64 Prefilter::Find(char const* text, uint64 const& size, uint64 position) const
+{
+	if (position >= size)
+		return size;
+
+	switch (_kind)
+	{
+		case PREFILTER_BYTES:
+		{
+			if (_startBytes.size() == 1)
+			{
+				void const* found = memchr(text + position, _startBytes[0], size - position);
+				return found ? static_cast<char const*>(found) - text : size;
+			}
+
+			for (; position < size; position += ScanBlockSize)
+			{
+				uint64 const length = std::min(ScanBlockSize, size - position);
+				char const* nearest = nullptr;
+
+				for (uint32 i = 0; i < _startBytes.size(); ++i)
+				{
+					// Only the part before the nearest match so far is left to scan.
+					uint64 const left = nearest ? nearest - (text + position) : length;
+					char const* found = static_cast<char const*>(memchr(text + position, _startBytes[i], left));
+
+					if (found)
+						nearest = found;
+				}
+
+				if (nearest)
+					return nearest - text;
+			}
+
+			return size;
+		}
+		case PREFILTER_BYTE_SET:
+		{
+			while (position < size && !_startSet[static_cast<uint8>(text[position])])
+				++position;
+
+			return position;
+		}
+		case PREFILTER_PREFIX:
+		{
+			while (size - position >= _prefix.size())
+			{
+				char const* found = static_cast<char const*>(memchr(text + position, _prefix[0], size - position - _prefix.size() + 1));
+
+				if (!found)
+					return size;
+
+				position = found - text;
+
+				if (!memcmp(found + 1, _prefix.data() + 1, _prefix.size() - 1))
+					return position;
+
+				++position;
+			}
+
+			return size;
+		}
+		default:
+			return position;
+	}
+}
+
+Searcher::Searcher(DFA const& dfa, bool usePrefilter) : _prefilter(dfa), _usePrefilter(usePrefilter), _table(GetLiveDFA(dfa))
+{
+	_prefixState = _table.GetInitialState();
+
+	for (String::const_iterator itr = _prefilter.GetPrefix().begin(); itr != _prefilter.GetPrefix().end(); ++itr)
+		_prefixState = _table.GetNextState(_prefixState, static_cast<uint8>(*itr));
+}
+
+bool Searcher::Find(String const& text, uint64 const& position, SearchMatch* match) const
+{
+	if (!_prefilter.CanMatch() || position > text.size())
+		return false;
+
+	char const* data = text.data();
+	uint64 const size = text.size();
+	bool const prefix = _usePrefilter && _prefilter.GetKind() == Prefilter::PREFILTER_PREFIX;
+	uint64 end;
+
+	for (uint64 start = position; start <= size; ++start)
+	{
+		if (_usePrefilter)
+		{
+			start = _prefilter.Find(data, size, start);
+
+			// Only the empty word can match at the end, and then every position is a candidate.
+			if (start == size && _prefilter.GetKind() != Prefilter::PREFILTER_NONE)
+				return false;
+		}
+
+		// The prefilter already compared the prefix.
+		bool matched = prefix ? Match(data, size, _prefixState, start + _prefilter.GetPrefix().size(), &end) :
+			Match(data, size, _table.GetInitialState(), start, &end);
+
+		if (matched)
+		{
+			*match = SearchMatch(start, end - start);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+SearchMatchesVector Searcher::FindAll(String const& text) const
+{
+	SearchMatchesVector matches;
+	SearchMatch match;
+
+	for (uint64 position = 0; position <= text.size() && Find(text, position, &match); 
+		position = match.position + std::max<uint64>(match.length, 1))
+		matches.push_back(match);
+
+	return matches;
+}
+
+bool Searcher::Match(char const* text, uint64 const& size, uint32 state, uint64 position, uint64* end) const
+{
+	bool matched = false;
+
+	while (true)
+	{
+		if (_table.IsFinalState(state))
+		{
+			matched = true;
+			*end = position;
+		}
+
+		if (position == size)
+			break;
+
+		state = _table.GetNextState(state, static_cast<uint8>(text[position++]));
+
+		// Only live states are left in the table, the dead state ends every run.
+		if (state == TransitionTable::InvalidState)
+			break;
+	}
+
+	return matched;
+}
+
@@ -0,0 +1,84 @@
+#ifndef LFA_LIB_SEARCHER_H
+#define LFA_LIB_SEARCHER_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+#include "CompressedTable.h"
+
+// Skips the positions of a text where no match of a DFA can start.
+// Built from the live part of the DFA, the states a final state is reachable from:
+// - PREFILTER_PREFIX when every match starts with the same literal of at least two bytes,
+// - PREFILTER_BYTES when at most three bytes can start a match,
+// - PREFILTER_BYTE_SET for any other strict subset of the bytes,
+// - PREFILTER_NONE when every position is a candidate, e.g. the empty word is accepted.
+// Single bytes and prefixes are searched with memchr, which the C runtime vectorizes.
+// Only what a match starts with is used. A literal required inside the matches would need a
+// run of the reversed DFA back from each hit to find where the match starts, so it is not extracted.
+class Prefilter
+{
+	public:
+		enum Kind
+		{
+			PREFILTER_NONE,
+			PREFILTER_BYTES,
+			PREFILTER_BYTE_SET,
+			PREFILTER_PREFIX
+		};
+
+		explicit Prefilter(DFA const& dfa);
+
+		Kind GetKind() const { return _kind; }
+		String const& GetPrefix() const { return _prefix; }	// Literal every match starts with, maybe empty.
+		String const& GetStartBytes() const { return _startBytes; }	// In symbol order.
+		bool CanMatch() const { return _canMatch; }
+
+		// First candidate start in [position, size), size if there is none.
+		uint64 Find(char const* text, uint64 const& size, uint64 position) const;
+
+	private:
+		Kind _kind;
+		bool _canMatch;
+		String _prefix;
+		String _startBytes;
+		bool _startSet[256];
+};
+
+struct SearchMatch
+{
+	uint64 position;
+	uint64 length;
+
+	SearchMatch() : position(0), length(0) { }
+	SearchMatch(uint64 const& position, uint64 const& length) : position(position), length(length) { }
+};
+
+typedef Vector<SearchMatch> SearchMatchesVector;
+
+// Unanchored search of the words of a DFA in a text, leftmost longest.
+// The DFA is only run from the candidates of its Prefilter, over a CompressedTable
+// of its live states, so the run stops once no match can follow.
+class Searcher
+{
+	public:
+		explicit Searcher(DFA const& dfa, bool usePrefilter = true);
+
+		Prefilter const& GetPrefilter() const { return _prefilter; }
+
+		// Leftmost longest match starting at position or later.
+		bool Find(String const& text, uint64 const& position, SearchMatch* match) const;
+
+		// Non overlapping matches from left to right. Empty matches are reported and skip a byte.
+		SearchMatchesVector FindAll(String const& text) const;
+
+	private:
+		Prefilter _prefilter;
+		bool _usePrefilter;
+		CompressedTable _table;
+		uint32 _prefixState;	// State reached on the prefix.
+
+		// Runs from state at position, *end is where the longest match ends.
+		bool Match(char const* text, uint64 const& size, uint32 state, uint64 position, uint64* end) const;
+};
+
+#endif
+
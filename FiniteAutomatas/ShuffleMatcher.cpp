@@ -0,0 +1,233 @@
+#include "PCH.h"
+#include "ShuffleMatcher.h"
+#include "TransitionTable.h"
+
+#ifdef LFA_X86
+	#include <immintrin.h>
+
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define LFA_TARGET(features)
+	#else
+		#define LFA_TARGET(features) __attribute__((target(features)))
+	#endif
+#endif
+
+namespace
+{
+	typedef uint8 const (*ShuffleTable)[ShuffleMatcher::Lanes];
+
+	// Bytes the vector kernels run before the dead state is looked for, a word that dies early
+	// costs this much instead of its whole length.
+	uint64 const DeadCheckLength = 64;
+
+	void RunScalar(ShuffleTable table, char const* begin, char const* end, uint8* lanes)
+	{
+		for (; begin != end; ++begin)
+		{
+			uint8 const* transitions = table[static_cast<uint8>(*begin)];
+
+			for (uint32 i = 0; i < ShuffleMatcher::Lanes; ++i)
+				lanes[i] = transitions[lanes[i]];
+		}
+	}
+
+#ifdef LFA_X86
+	ShuffleMatcher::Engine DetectEngine()
+	{
+		bool ssse3 = false, avx2 = false;
+
+	#ifdef _MSC_VER
+		int info[4];
+
+		__cpuid(info, 0);
+		int leaves = info[0];
+
+		__cpuid(info, 1);
+		ssse3 = (info[2] & (1 << 9)) != 0;
+
+		// AVX2 also needs the OS to save the ymm registers.
+		if (leaves >= 7 && (info[2] & (1 << 27)) && ((_xgetbv(0) & 6) == 6))
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+	#else
+		__builtin_cpu_init();
+		ssse3 = __builtin_cpu_supports("ssse3") != 0;
+		avx2 = __builtin_cpu_supports("avx2") != 0;
+	#endif
+
+		if (avx2)
+			return ShuffleMatcher::ENGINE_AVX2;
+
+		return ssse3 ? ShuffleMatcher::ENGINE_SSSE3 : ShuffleMatcher::ENGINE_SCALAR;
+	}
+
+	LFA_TARGET("ssse3")
+	void RunSSSE3(ShuffleTable table, char const* begin, char const* end, uint8* lanes)
+	{
+		__m128i state = _mm_loadu_si128(reinterpret_cast<__m128i const*>(lanes));
+
+		// The rows are loaded unaligned too, new only aligns a cached matcher to 8 bytes in 32 bit builds.
+		for (; begin != end; ++begin)
+		{
+			__m128i transitions = _mm_loadu_si128(reinterpret_cast<__m128i const*>(table[static_cast<uint8>(*begin)]));
+			state = _mm_shuffle_epi8(transitions, state);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), state);
+	}
+
+	// Runs the first length bytes of two words, one in each 128 bit half.
+	LFA_TARGET("avx2")
+	void RunPairAVX2(ShuffleTable table, char const* first, char const* second, uint64 const& length,
+		uint8* firstLanes, uint8* secondLanes)
+	{
+		__m256i state = _mm256_inserti128_si256(_mm256_castsi128_si256(
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(firstLanes))),
+			_mm_loadu_si128(reinterpret_cast<__m128i const*>(secondLanes)), 1);
+
+		for (uint64 i = 0; i < length; ++i)
+		{
+			__m256i transitions = _mm256_inserti128_si256(_mm256_castsi128_si256(
+				_mm_loadu_si128(reinterpret_cast<__m128i const*>(table[static_cast<uint8>(first[i])]))),
+				_mm_loadu_si128(reinterpret_cast<__m128i const*>(table[static_cast<uint8>(second[i])])), 1);
+			state = _mm256_shuffle_epi8(transitions, state);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(firstLanes), _mm256_castsi256_si128(state));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(secondLanes), _mm256_extracti128_si256(state, 1));
+	}
+#endif
+
+	void InitializeLanes(uint8* lanes)
+	{
+		for (uint32 i = 0; i < ShuffleMatcher::Lanes; ++i)
+			lanes[i] = static_cast<uint8>(i);
+	}
+}
+
+uint32 const ShuffleMatcher::Lanes;
+
+bool ShuffleMatcher::CanMatch(DFA const& dfa)
+{
+	// One lane is kept for the dead state, unless every state has a transition on every byte.
+	// Removed states keep their indexes, so the row count of the table is what has to fit.
+	if (!dfa.HasStates() || dfa.GetStatesCount() > Lanes)
+		return false;
+
+	TransitionTable const& table = dfa.GetTransitionTable();
+
+	return table.GetStates() < Lanes || (table.GetStates() == Lanes && table.GetEdgesCount() == Lanes * 256);
+}
+
+ShuffleMatcher::ShuffleMatcher(DFA const& dfa) : _finalStates(0), _initialState(0), _deadState(0), _engine(ENGINE_SCALAR)
+{
+	assert(CanMatch(dfa));
+
+	TransitionTable const& table = dfa.GetTransitionTable();
+	StatesSet const finalStates = dfa.GetFinalStates();
+
+	_deadState = static_cast<uint8>(table.GetStates());
+	_initialState = static_cast<uint8>(dfa.GetInitialState());
+
+	memset(_table, _deadState, sizeof(_table));
+
+	for (uint32 state = 0; state < table.GetStates(); ++state)
+		for (uint32 edge = table.GetEdgesBegin(state); edge < table.GetEdgesEnd(state); ++edge)
+			_table[static_cast<uint8>(table.GetSymbol(edge))][state] = static_cast<uint8>(*table.GetTargets(edge).first);
+
+	for (StatesSetConstIterator itr = finalStates.begin(); itr != finalStates.end(); ++itr)
+		if ((*itr) < _deadState)
+			_finalStates |= static_cast<uint16>(1 << (*itr));
+
+#ifdef LFA_X86
+	_engine = DetectEngine();
+#endif
+}
+
+bool ShuffleMatcher::IsAccepted(String const& word) const
+{
+	if (_engine == ENGINE_SCALAR)
+	{
+		uint8 state = _initialState;
+
+		for (String::const_iterator itr = word.begin(); itr != word.end() && state != _deadState; ++itr)
+			state = _table[static_cast<uint8>(*itr)][state];
+
+		return IsFinalState(state);
+	}
+
+	uint8 lanes[Lanes];
+	InitializeLanes(lanes);
+	RunWord(word.data(), word.data() + word.size(), lanes);
+
+	return IsFinalState(lanes[_initialState]);
+}
+
+Vector<bool> ShuffleMatcher::IsAccepted(Vector<String> const& words) const
+{
+	Vector<bool> accepted(words.size(), false);
+	uint32 i = 0;
+
+#ifdef LFA_X86
+	if (_engine == ENGINE_AVX2)
+	{
+		for (; i + 1 < words.size(); i += 2)
+		{
+			String const& first = words[i];
+			String const& second = words[i + 1];
+			uint64 const length = std::min(first.size(), second.size());
+			uint64 position = 0;
+			uint8 firstLanes[Lanes], secondLanes[Lanes];
+
+			InitializeLanes(firstLanes);
+			InitializeLanes(secondLanes);
+
+			while (position < length && (firstLanes[_initialState] != _deadState || secondLanes[_initialState] != _deadState))
+			{
+				uint64 const step = std::min(DeadCheckLength, length - position);
+				RunPairAVX2(_table, first.data() + position, second.data() + position, step, firstLanes, secondLanes);
+				position += step;
+			}
+
+			RunWord(first.data() + position, first.data() + first.size(), firstLanes);
+			RunWord(second.data() + position, second.data() + second.size(), secondLanes);
+
+			accepted[i] = IsFinalState(firstLanes[_initialState]);
+			accepted[i + 1] = IsFinalState(secondLanes[_initialState]);
+		}
+	}
+#endif
+
+	for (; i < words.size(); ++i)
+		accepted[i] = IsAccepted(words[i]);
+
+	return accepted;
+}
+
+void ShuffleMatcher::Run(char const* begin, char const* end, uint8 lanes[Lanes]) const
+{
+#ifdef LFA_X86
+	if (_engine != ENGINE_SCALAR)
+	{
+		RunSSSE3(_table, begin, end, lanes);
+		return;
+	}
+#endif
+
+	RunScalar(_table, begin, end, lanes);
+}
+
+void ShuffleMatcher::RunWord(char const* begin, char const* end, uint8 lanes[Lanes]) const
+{
+	// The dead state only leads to itself.
+	while (begin != end && lanes[_initialState] != _deadState)
+	{
+		char const* const next = (static_cast<uint64>(end - begin) > DeadCheckLength) ? begin + DeadCheckLength : end;
+		Run(begin, next, lanes);
+		begin = next;
+	}
+}
+
@@ -0,0 +1,57 @@
+#ifndef LFA_LIB_SHUFFLE_MATCHER_H
+#define LFA_LIB_SHUFFLE_MATCHER_H
+
+#include "PCH.h"
+#include "DeterministicFiniteAutomata.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define LFA_X86
+#endif
+
+// Matching engine for DFAs with at most 15 states plus the dead state, or 16 states
+// when the automaton is complete over all 256 bytes and never reaches the dead state.
+// The transition function is kept per byte as a vector of 16 lanes, lane i holding the
+// state reached from state i. Running a byte composes it with the current lanes, which is
+// a single byte shuffle (PSHUFB), so after a word lane i is the state the word leads i to.
+// The SSSE3 and AVX2 kernels are picked at runtime, with a scalar fallback.
+class ShuffleMatcher
+{
+	public:
+		static uint32 const Lanes = 16;
+
+		enum Engine
+		{
+			ENGINE_SCALAR,
+			ENGINE_SSSE3,
+			ENGINE_AVX2	// Runs two words at once, one per 128 bit half.
+		};
+
+		static bool CanMatch(DFA const& dfa);
+
+		explicit ShuffleMatcher(DFA const& dfa);
+
+		Engine GetEngine() const { return _engine; }
+
+		uint8 GetInitialState() const { return _initialState; }
+		uint8 GetDeadState() const { return _deadState; }
+		bool IsFinalState(uint8 const& state) const { return ((_finalStates >> state) & 1) != 0; }
+
+		bool IsAccepted(String const& word) const;
+		Vector<bool> IsAccepted(Vector<String> const& words) const;
+
+		// Composes lanes with the transitions of [begin, end).
+		void Run(char const* begin, char const* end, uint8 lanes[Lanes]) const;
+
+	private:
+		// Like Run, but stops once the lane of the initial state is in the dead state.
+		void RunWord(char const* begin, char const* end, uint8 lanes[Lanes]) const;
+
+		alignas(16) uint8 _table[256][Lanes];
+		uint16 _finalStates;
+		uint8 _initialState;
+		uint8 _deadState;	// Lanes when the automaton is complete.
+		Engine _engine;
+};
+
+#endif
+
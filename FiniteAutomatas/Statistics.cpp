@@ -0,0 +1,98 @@
+#include "PCH.h"
+#include "Statistics.h"
+
+namespace
+{
+	std::mutex sinkMutex;
+	StatisticsSink sink;
+
+	thread_local uint32 depth = 0;
+	thread_local AutomataStatistics current;
+	thread_local AutomataStatistics last;
+
+	uint64 ElapsedMicroseconds(std::chrono::steady_clock::time_point const& start)
+	{
+		return static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count());
+	}
+}
+
+void AutomataStatistics::Reset(String const& operationName)
+{
+	operation = operationName;
+	subsetsExplored = 0;
+	subsetsStates = 0;
+	lambdaClosures = 0;
+	refinementRounds = 0;
+	refinementSplits = 0;
+	transitionLookups = 0;
+	duration = 0;
+	phaseDurations.clear();
+}
+
+double AutomataStatistics::GetAverageSubsetSize() const
+{
+	if (!subsetsExplored)
+		return 0.0;
+
+	return static_cast<double>(subsetsStates) / static_cast<double>(subsetsExplored);
+}
+
+void Statistics::SetSink(StatisticsSink const& statisticsSink)
+{
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	sink = statisticsSink;
+}
+
+AutomataStatistics Statistics::GetLastStatistics()
+{
+	return last;
+}
+
+AutomataStatistics* Statistics::GetCurrent()
+{
+	return depth ? &current : nullptr;
+}
+
+Statistics::OperationScope::OperationScope(String const& name) : _name(name), _outermost(depth == 0),
+	_start(std::chrono::steady_clock::now())
+{
+	if (_outermost)
+		current.Reset(name);
+
+	++depth;
+}
+
+Statistics::OperationScope::~OperationScope()
+{
+	--depth;
+
+	uint64 duration = ElapsedMicroseconds(_start);
+
+	if (!_outermost)
+	{
+		current.phaseDurations[_name] += duration;
+		return;
+	}
+
+	current.duration = duration;
+	last = current;
+
+	StatisticsSink statisticsSink;
+	{
+		std::lock_guard<std::mutex> lock(sinkMutex);
+		statisticsSink = sink;
+	}
+
+	if (statisticsSink)
+		statisticsSink(last);
+}
+
+Statistics::PhaseScope::PhaseScope(String const& name) : _name(name), _start(std::chrono::steady_clock::now()) { }
+
+Statistics::PhaseScope::~PhaseScope()
+{
+	if (depth)
+		current.phaseDurations[_name] += ElapsedMicroseconds(_start);
+}
+
@@ -0,0 +1,92 @@
+#ifndef LFA_LIB_STATISTICS_H
+#define LFA_LIB_STATISTICS_H
+
+#include "PCH.h"
+
+// Counters and timings collected while an automaton algorithm runs.
+// Collection is compiled in only when LFA_ENABLE_STATISTICS is defined,
+// otherwise every LFA_STATISTICS_* macro expands to nothing.
+struct AutomataStatistics
+{
+	String operation;
+
+	uint64 subsetsExplored;		// Subsets expanded by the subset construction.
+	uint64 subsetsStates;		// Sum of the sizes of the explored subsets.
+	uint64 lambdaClosures;
+	uint64 refinementRounds;	// Hopcroft splitters processed or Moore pairs propagated.
+	uint64 refinementSplits;	// Hopcroft blocks split or Moore pairs marked distinct.
+	uint64 transitionLookups;
+
+	uint64 duration;	// Microseconds
+	Map<String, uint64> phaseDurations;	// Microseconds
+
+	AutomataStatistics() { Reset(String()); }
+
+	void Reset(String const& operationName);
+
+	double GetAverageSubsetSize() const;
+};
+
+typedef std::function<void(AutomataStatistics const&)> StatisticsSink;
+
+namespace Statistics
+{
+	// The sink is called on the calling thread when an outermost operation ends.
+	void SetSink(StatisticsSink const& sink);
+
+	// Statistics of the last outermost operation finished on the calling thread.
+	AutomataStatistics GetLastStatistics();
+
+	// Statistics of the operation running on the calling thread, nullptr if there is none.
+	AutomataStatistics* GetCurrent();
+
+	// Starts an operation. Operations started while another one is running
+	// on the same thread are recorded as phases of the outermost one.
+	class OperationScope
+	{
+		public:
+			explicit OperationScope(String const& name);
+			~OperationScope();
+
+		private:
+			String _name;
+			bool _outermost;
+			std::chrono::steady_clock::time_point _start;
+
+			OperationScope(OperationScope const&) = delete;
+			OperationScope& operator=(OperationScope const&) = delete;
+	};
+
+	class PhaseScope
+	{
+		public:
+			explicit PhaseScope(String const& name);
+			~PhaseScope();
+
+		private:
+			String _name;
+			std::chrono::steady_clock::time_point _start;
+
+			PhaseScope(PhaseScope const&) = delete;
+			PhaseScope& operator=(PhaseScope const&) = delete;
+	};
+}
+
+#define LFA_STATISTICS_CONCAT_IMPL(first, second) first##second
+#define LFA_STATISTICS_CONCAT(first, second) LFA_STATISTICS_CONCAT_IMPL(first, second)
+
+#ifdef LFA_ENABLE_STATISTICS
+	#define LFA_STATISTICS_OPERATION(name) \
+		Statistics::OperationScope LFA_STATISTICS_CONCAT(_statisticsOperation, __LINE__)(name)
+	#define LFA_STATISTICS_PHASE(name) \
+		Statistics::PhaseScope LFA_STATISTICS_CONCAT(_statisticsPhase, __LINE__)(name)
+	#define LFA_STATISTICS_ADD(counter, value) \
+		do { if (AutomataStatistics* _statistics = Statistics::GetCurrent()) _statistics->counter += (value); } while (false)
+#else
+	#define LFA_STATISTICS_OPERATION(name) ((void)0)
+	#define LFA_STATISTICS_PHASE(name) ((void)0)
+	#define LFA_STATISTICS_ADD(counter, value) ((void)0)
+#endif
+
+#endif
+
@@ -0,0 +1,290 @@
+#include "PCH.h"
+#include "TransitionTable.h"
+
+uint32 const TransitionTable::InvalidState = 0xFFFFFFFF;
+
+TransitionTable::TransitionTable(uint32 const& states, TransitionMap const& transitionFunction) : _deterministic(true)
+{
+	// States may have been removed without renumbering the others.
+	uint32 rows = states;
+	uint32 transitions = 0;
+
+	for (TransitionMapConstIterator itr = transitionFunction.begin(); itr != transitionFunction.end(); ++itr)
+	{
+		rows = std::max(rows, itr->first.first + 1);
+		transitions += static_cast<uint32>(itr->second.size());
+
+		for (StatesConstIterator iter = itr->second.begin(); iter != itr->second.end(); ++iter)
+			rows = std::max(rows, (*iter) + 1);
+
+		if (itr->second.size() != 1)
+			_deterministic = false;
+	}
+
+	_stateOffsets.assign(rows + 1, 0);
+	_symbols.reserve(transitionFunction.size());
+	_targets.reserve(transitions);
+
+	if (!_deterministic)
+	{
+		_targetOffsets.reserve(transitionFunction.size() + 1);
+		_targetOffsets.push_back(0);
+	}
+
+	// TransitionMap is ordered by (state, symbol) so it already is in row order.
+	for (TransitionMapConstIterator itr = transitionFunction.begin(); itr != transitionFunction.end(); ++itr)
+	{
+		++_stateOffsets[itr->first.first + 1];
+		_symbols.push_back(itr->first.second);
+		_targets.insert(_targets.end(), itr->second.begin(), itr->second.end());
+
+		if (!_deterministic)
+			_targetOffsets.push_back(static_cast<uint32>(_targets.size()));
+	}
+
+	for (uint32 i = 0; i < rows; ++i)
+		_stateOffsets[i + 1] += _stateOffsets[i];
+}
+
+TransitionTable::TransitionTable(uint32 const& states, TransitionsVector transitions) : _deterministic(true)
+{
+	std::sort(transitions.begin(), transitions.end());
+	transitions.erase(std::unique(transitions.begin(), transitions.end()), transitions.end());
+
+	Build(states, transitions);
+}
+
+TargetsRange TransitionTable::GetTargets(uint32 const& edge) const
+{
+	uint32 const* targets = _targets.data();
+
+	if (_deterministic)
+		return TargetsRange(targets + edge, targets + edge + 1);
+
+	return TargetsRange(targets + _targetOffsets[edge], targets + _targetOffsets[edge + 1]);
+}
+
+uint32 TransitionTable::FindEdge(uint32 const& state, char const& key) const
+{
+	if (state >= GetStates())
+		return InvalidState;
+
+	Vector<char>::const_iterator first = _symbols.begin() + _stateOffsets[state];
+	Vector<char>::const_iterator last = _symbols.begin() + _stateOffsets[state + 1];
+	Vector<char>::const_iterator itr = std::lower_bound(first, last, key);
+
+	if (itr == last || (*itr) != key)
+		return InvalidState;
+
+	return static_cast<uint32>(itr - _symbols.begin());
+}
+
+TargetsRange TransitionTable::Find(uint32 const& state, char const& key) const
+{
+	uint32 edge = FindEdge(state, key);
+
+	if (edge == InvalidState)
+		return TargetsRange(nullptr, nullptr);
+
+	return GetTargets(edge);
+}
+
+uint32 TransitionTable::GetNextState(uint32 const& state, char const& key) const
+{
+	uint32 edge = FindEdge(state, key);
+
+	if (edge == InvalidState)
+		return InvalidState;
+
+	return _deterministic ? _targets[edge] : _targets[_targetOffsets[edge]];
+}
+
+void TransitionTable::AddTargets(StatesVector const& states, char const& key, StatesVector* result, 
+	StatesVector* marks, uint32 const& stamp) const
+{
+	for (StatesConstIterator itr = states.begin(); itr != states.end(); ++itr)
+	{
+		TargetsRange targets = Find(*itr, key);
+
+		for (uint32 const* iter = targets.first; iter != targets.second; ++iter)
+			if ((*marks)[*iter] != stamp)
+			{
+				(*marks)[*iter] = stamp;
+				result->push_back(*iter);
+			}
+	}
+}
+
+void TransitionTable::AddClosure(char const& key, StatesVector* states, StatesVector* marks, uint32 const& stamp) const
+{
+	for (uint32 i = 0; i < states->size(); ++i)
+	{
+		TargetsRange targets = Find((*states)[i], key);
+
+		for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+			if ((*marks)[*itr] != stamp)
+			{
+				(*marks)[*itr] = stamp;
+				states->push_back(*itr);
+			}
+	}
+
+	std::sort(states->begin(), states->end());
+}
+
+Vector<bool> TransitionTable::GetUsefulStates(uint32 const& initialState, Vector<bool> const& finalStates) const
+{
+	Vector<bool> reachable(GetStates(), false), useful(GetStates(), false);
+	StatesVector stack(1, initialState);
+
+	reachable[initialState] = true;
+
+	while (!stack.empty())
+	{
+		uint32 state = stack.back();
+		stack.pop_back();
+
+		for (uint32 edge = GetEdgesBegin(state); edge < GetEdgesEnd(state); ++edge)
+		{
+			TargetsRange targets = GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				if (!reachable[*itr])
+				{
+					reachable[*itr] = true;
+					stack.push_back(*itr);
+				}
+		}
+	}
+
+	TransitionTable const reverse = GetReverse();
+
+	for (uint32 state = 0; state < GetStates(); ++state)
+		if (reachable[state] && finalStates[state])
+		{
+			useful[state] = true;
+			stack.push_back(state);
+		}
+
+	while (!stack.empty())
+	{
+		uint32 state = stack.back();
+		stack.pop_back();
+
+		for (uint32 edge = reverse.GetEdgesBegin(state); edge < reverse.GetEdgesEnd(state); ++edge)
+		{
+			TargetsRange targets = reverse.GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				if (reachable[*itr] && !useful[*itr])
+				{
+					useful[*itr] = true;
+					stack.push_back(*itr);
+				}
+		}
+	}
+
+	return useful;
+}
+
+TransitionTable TransitionTable::GetReverse() const
+{
+	TransitionsVector transitions;
+	transitions.reserve(_targets.size());
+
+	for (uint32 state = 0; state < GetStates(); ++state)
+		for (uint32 edge = GetEdgesBegin(state); edge < GetEdgesEnd(state); ++edge)
+		{
+			TargetsRange targets = GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				transitions.emplace_back(TransitionPair(*itr, _symbols[edge]), state);
+		}
+
+	return TransitionTable(GetStates(), transitions);
+}
+
+TransitionsVector TransitionTable::GetTransitions() const
+{
+	TransitionsVector transitions;
+	transitions.reserve(_targets.size());
+
+	for (uint32 state = 0; state < GetStates(); ++state)
+		for (uint32 edge = GetEdgesBegin(state); edge < GetEdgesEnd(state); ++edge)
+		{
+			TargetsRange targets = GetTargets(edge);
+
+			for (uint32 const* itr = targets.first; itr != targets.second; ++itr)
+				transitions.emplace_back(TransitionPair(state, _symbols[edge]), *itr);
+		}
+
+	return transitions;
+}
+
+TransitionMap TransitionTable::ToTransitionMap() const
+{
+	TransitionMap transitionFunction;
+
+	for (uint32 state = 0; state < GetStates(); ++state)
+		for (uint32 edge = GetEdgesBegin(state); edge < GetEdgesEnd(state); ++edge)
+		{
+			TargetsRange targets = GetTargets(edge);
+			transitionFunction.emplace_hint(transitionFunction.end(), TransitionPair(state, _symbols[edge]),
+				StatesVector(targets.first, targets.second));
+		}
+
+	return transitionFunction;
+}
+
+uint64 TransitionTable::GetMemoryUsage() const
+{
+	return sizeof(uint32) * (_stateOffsets.size() + _targets.size() + _targetOffsets.size()) + _symbols.size();
+}
+
+void TransitionTable::Build(uint32 const& states, TransitionsVector const& transitions)
+{
+	// transitions must be sorted and without duplicates.
+	uint32 rows = states;
+	uint32 edges = 0;
+
+	for (uint32 i = 0; i < transitions.size(); ++i)
+	{
+		rows = std::max(rows, std::max(transitions[i].first.first, transitions[i].second) + 1);
+
+		if (i && transitions[i - 1].first == transitions[i].first)
+			_deterministic = false;
+		else
+			++edges;
+	}
+
+	_stateOffsets.assign(rows + 1, 0);
+	_symbols.reserve(edges);
+	_targets.reserve(transitions.size());
+
+	if (!_deterministic)
+	{
+		_targetOffsets.reserve(edges + 1);
+		_targetOffsets.push_back(0);
+	}
+
+	for (uint32 i = 0; i < transitions.size(); ++i)
+	{
+		if (!i || transitions[i - 1].first != transitions[i].first)
+		{
+			if (i && !_deterministic)
+				_targetOffsets.push_back(static_cast<uint32>(_targets.size()));
+
+			++_stateOffsets[transitions[i].first.first + 1];
+			_symbols.push_back(transitions[i].first.second);
+		}
+
+		_targets.push_back(transitions[i].second);
+	}
+
+	if (!_deterministic && !transitions.empty())
+		_targetOffsets.push_back(static_cast<uint32>(_targets.size()));
+
+	for (uint32 i = 0; i < rows; ++i)
+		_stateOffsets[i + 1] += _stateOffsets[i];
+}
+
@@ -0,0 +1,72 @@
+#ifndef LFA_LIB_TRANSITION_TABLE_H
+#define LFA_LIB_TRANSITION_TABLE_H
+
+#include "PCH.h"
+
+typedef Set<uint32> StatesSet;
+typedef Vector<uint32> StatesVector;
+typedef Pair<uint32, char> TransitionPair;
+typedef Map<TransitionPair, StatesVector> TransitionMap;
+typedef StatesVector::const_iterator StatesConstIterator;
+typedef StatesSet::const_iterator StatesSetConstIterator;
+typedef TransitionMap::const_iterator TransitionMapConstIterator;
+typedef Pair<uint32 const*, uint32 const*> TargetsRange;
+typedef Vector<Pair<TransitionPair, uint32>> TransitionsVector;
+
+// Read-only transition storage in compressed sparse rows.
+// The edges of a state are contiguous and sorted by symbol. A deterministic table
+// keeps the only target of every edge inline, so an edge costs 5 bytes. A nondeterministic
+// table keeps for every edge an offset range into a shared targets pool.
+// The whole table lives in at most four exactly sized arrays.
+class TransitionTable
+{
+	public:
+		static uint32 const InvalidState;
+
+		TransitionTable() : _deterministic(true), _stateOffsets(1, 0) { }
+		TransitionTable(uint32 const& states, TransitionMap const& transitionFunction);
+		TransitionTable(uint32 const& states, TransitionsVector transitions);	// Any order, duplicates allowed.
+
+		uint32 GetStates() const { return static_cast<uint32>(_stateOffsets.size() - 1); }
+		uint32 GetEdgesCount() const { return static_cast<uint32>(_symbols.size()); }
+		uint32 GetTransitionsCount() const { return static_cast<uint32>(_targets.size()); }
+
+		bool IsDeterministic() const { return _deterministic; }
+
+		// Edges of state are in [GetEdgesBegin(state), GetEdgesEnd(state)).
+		uint32 GetEdgesBegin(uint32 const& state) const { return _stateOffsets[state]; }
+		uint32 GetEdgesEnd(uint32 const& state) const { return _stateOffsets[state + 1]; }
+
+		char GetSymbol(uint32 const& edge) const { return _symbols[edge]; }
+		TargetsRange GetTargets(uint32 const& edge) const;
+
+		uint32 FindEdge(uint32 const& state, char const& key) const;	// InvalidState if there is no such edge.
+		TargetsRange Find(uint32 const& state, char const& key) const;
+		uint32 GetNextState(uint32 const& state, char const& key) const;	// First target or InvalidState.
+
+		// Subset helpers for the determinization algorithms. marks[state] == stamp tells
+		// that state is already in the result, so a fresh stamp starts an empty result.
+		void AddTargets(StatesVector const& states, char const& key, StatesVector* result, StatesVector* marks, uint32 const& stamp) const;
+		void AddClosure(char const& key, StatesVector* states, StatesVector* marks, uint32 const& stamp) const;	// Sorts states.
+
+		// Marks the states reachable from initialState which can also reach a state marked in finalStates.
+		Vector<bool> GetUsefulStates(uint32 const& initialState, Vector<bool> const& finalStates) const;
+
+		TransitionTable GetReverse() const;
+		TransitionsVector GetTransitions() const;	// Sorted, one entry per target.
+		TransitionMap ToTransitionMap() const;
+
+		uint64 GetMemoryUsage() const;	// Bytes used by the arrays.
+
+	private:
+		bool _deterministic;
+		StatesVector _stateOffsets;		// GetStates() + 1 offsets into _symbols.
+		Vector<char> _symbols;			// One per edge.
+		StatesVector _targets;			// One per edge if deterministic, the targets pool otherwise.
+		StatesVector _targetOffsets;	// GetEdgesCount() + 1 offsets into _targets, empty if deterministic.
+
+		void Build(uint32 const& states, TransitionsVector const& transitions);
+};
+
+#endif
+